@@ -0,0 +1,101 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+// куски выделяются с этим выравниванием, большее добирается сдвигом
+constexpr size_t CHUNK_ALIGNMENT = alignof(max_align_t);
+// удвоение размера кусков останавливается на нём
+constexpr size_t MAX_CHUNK_SIZE = size_t{16} << 20;
+
+struct ScratchState {
+    Arena arena;
+    size_t depth = 0;
+};
+
+ScratchState& GetScratchState() {
+    thread_local ScratchState state;
+    return state;
+}
+
+} // namespace
+
+Arena::Arena(size_t first_chunk_size)
+    : next_chunk_size_(max<size_t>(first_chunk_size, CHUNK_ALIGNMENT)) {
+}
+
+Arena::~Arena() {
+    Release();
+}
+
+string_view Arena::CopyString(string_view text) {
+    if (text.empty()) {
+        return {};
+    }
+    char* data = static_cast<char*>(allocate(text.size(), 1));
+    memcpy(data, text.data(), text.size());
+    return {data, text.size()};
+}
+
+void Arena::Reset() {
+    current_ = 0;
+    offset_ = 0;
+}
+
+void Arena::Release() {
+    for (const Chunk& chunk : chunks_) {
+        ::operator delete(chunk.data, align_val_t{CHUNK_ALIGNMENT});
+    }
+    chunks_.clear();
+    Reset();
+}
+
+size_t Arena::GetCapacity() const {
+    size_t result = 0;
+    for (const Chunk& chunk : chunks_) {
+        result += chunk.size;
+    }
+    return result;
+}
+
+void* Arena::do_allocate(size_t bytes, size_t alignment) {
+    // После Reset куски проходятся заново по порядку. Блок, не влезший в
+    // остаток куска, переходит в следующий; остаток пропадает до Reset
+    while (true) {
+        for (; current_ < chunks_.size(); ++current_, offset_ = 0) {
+            const Chunk& chunk = chunks_[current_];
+            const auto base = reinterpret_cast<uintptr_t>(chunk.data);
+            const uintptr_t aligned = (base + offset_ + alignment - 1) & ~(uintptr_t{alignment} - 1);
+            if (aligned + bytes <= base + chunk.size) {
+                offset_ = aligned + bytes - base;
+                return reinterpret_cast<void*>(aligned);
+            }
+        }
+        const size_t size = max(next_chunk_size_, bytes + alignment);
+        next_chunk_size_ = min(next_chunk_size_ * 2, MAX_CHUNK_SIZE);
+        chunks_.push_back({static_cast<byte*>(::operator new(size, align_val_t{CHUNK_ALIGNMENT})), size});
+        current_ = chunks_.size() - 1;
+        offset_ = 0;
+    }
+}
+
+ScratchScope::ScratchScope() {
+    ++GetScratchState().depth;
+}
+
+ScratchScope::~ScratchScope() {
+    ScratchState& state = GetScratchState();
+    if (--state.depth == 0) {
+        state.arena.Reset();
+    }
+}
+
+pmr::memory_resource* GetScratchResource() {
+    ScratchState& state = GetScratchState();
+    return state.depth > 0 ? &state.arena : pmr::get_default_resource();
+}
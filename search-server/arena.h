@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+// Монотонная арена: выделение - сдвиг указателя в текущем куске, а
+// освобождение отдельных блоков ничего не делает. Память возвращается только
+// целиком: Reset оставляет куски арене для повторного использования, поэтому
+// после разогрева она не обращается к куче, а Release отдаёт их. Не
+// потокобезопасна
+class Arena : public std::pmr::memory_resource {
+public:
+    explicit Arena(size_t first_chunk_size = 64 * 1024);
+    ~Arena() override;
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Копия строки в памяти арены
+    std::string_view CopyString(std::string_view text);
+
+    void Reset();
+    void Release();
+
+    // Память, взятая из кучи, в байтах
+    size_t GetCapacity() const;
+    size_t GetChunkCount() const {
+        return chunks_.size();
+    }
+
+private:
+    struct Chunk {
+        std::byte* data;
+        size_t size;
+    };
+
+    std::vector<Chunk> chunks_;
+    size_t current_ = 0;
+    size_t offset_ = 0;
+    size_t next_chunk_size_;
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+// Память на время одного запроса. Пока на потоке открыт хотя бы один
+// ScratchScope, GetScratchResource выдаёт арену потока; когда закрывается
+// самый внешний, арена сбрасывается целиком. Вложенные запросы на том же
+// потоке (например, подхваченные им задачи параллельного алгоритма)
+// продолжают ту же арену. Выделенное из неё не должно пережить scope
+class ScratchScope {
+public:
+    ScratchScope();
+    ~ScratchScope();
+
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+};
+
+// Арена текущего потока внутри ScratchScope, иначе обычная куча
+std::pmr::memory_resource* GetScratchResource();
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../concurrent_search_server.h"
+#include "../generators.h"
+
+using namespace std;
+
+// Задержка поиска под смешанной нагрузкой: несколько потоков непрерывно
+// ищут, а писатель параллельно добавляет и удаляет документы
+struct LatencyReport {
+    size_t queries = 0;
+    double p50_us = 0;
+    double p99_us = 0;
+    double max_us = 0;
+};
+
+LatencyReport RunReaders(const ConcurrentSearchServer& search_server, const vector<string>& queries,
+                         size_t reader_count, atomic<bool>& stop) {
+    vector<vector<double>> latencies(reader_count);
+    vector<thread> readers;
+    for (size_t r = 0; r < reader_count; ++r) {
+        readers.emplace_back([&, r] {
+            for (size_t i = r; !stop; i = (i + reader_count) % queries.size()) {
+                const auto start = chrono::steady_clock::now();
+                search_server.FindTopDocuments(queries[i]);
+                const chrono::duration<double, micro> duration = chrono::steady_clock::now() - start;
+                latencies[r].push_back(duration.count());
+            }
+        });
+    }
+    for (thread& reader : readers) {
+        reader.join();
+    }
+
+    vector<double> all;
+    for (const auto& part : latencies) {
+        all.insert(all.end(), part.begin(), part.end());
+    }
+    sort(all.begin(), all.end());
+    LatencyReport report;
+    report.queries = all.size();
+    if (!all.empty()) {
+        report.p50_us = all[all.size() / 2];
+        report.p99_us = all[all.size() * 99 / 100];
+        report.max_us = all.back();
+    }
+    return report;
+}
+
+void PrintReport(string_view mark, const LatencyReport& report, double seconds) {
+    cout << mark << ": "s << static_cast<size_t>(report.queries / seconds) << " queries/s, p50 "s << report.p50_us
+         << " us, p99 "s << report.p99_us << " us, max "s << report.max_us << " us"s << endl;
+}
+
+int main() {
+    using namespace chrono_literals;
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 2'000, 10);
+    const auto texts = GenerateQueries(generator, dictionary, 30'000, 50);
+    const auto queries = GenerateQueries(generator, dictionary, 1'000, 5);
+    const size_t reader_count = max(2u, thread::hardware_concurrency());
+    const auto duration = 3s;
+
+    ConcurrentSearchServer search_server(dictionary[0]);
+    const int initial_count = 20'000;
+    for (int i = 0; i < initial_count; ++i) {
+        search_server.AddDocument(i, texts[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+
+    {
+        atomic<bool> stop = false;
+        thread timer([&] {
+            this_thread::sleep_for(duration);
+            stop = true;
+        });
+        const auto report = RunReaders(search_server, queries, reader_count, stop);
+        timer.join();
+        PrintReport("read only"s, report, chrono::duration<double>(duration).count());
+    }
+    {
+        atomic<bool> stop = false;
+        size_t writes = 0;
+        thread writer([&] {
+            int next_id = initial_count;
+            int oldest_id = 0;
+            while (!stop) {
+                search_server.AddDocument(next_id, texts[next_id % texts.size()], DocumentStatus::ACTUAL, {1, 2, 3});
+                search_server.RemoveDocument(oldest_id++);
+                ++next_id;
+                writes += 2;
+            }
+        });
+        thread timer([&] {
+            this_thread::sleep_for(duration);
+            stop = true;
+        });
+        const auto report = RunReaders(search_server, queries, reader_count, stop);
+        timer.join();
+        writer.join();
+        const double seconds = chrono::duration<double>(duration).count();
+        PrintReport("with writer"s, report, seconds);
+        cout << "writes: "s << static_cast<size_t>(writes / seconds) << " ops/s"s << endl;
+    }
+}
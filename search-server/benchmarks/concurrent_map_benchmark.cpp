@@ -0,0 +1,111 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../concurrent_hash_map.h"
+#include "../concurrent_map.h"
+#include "../generators.h"
+#include "../string_processing.h"
+
+using namespace std;
+
+// Счётчики по ключам под нагрузкой от 1 до 64 потоков (Mops/s): ConcurrentMap
+// с мьютексом на корзину против ConcurrentHashMap с атомарным FetchAdd.
+// ConcurrentHashMap начинает с маленькой таблицы, поэтому в замер входят и
+// её расширения. Отдельно - ключи-слова (string_view), которых ConcurrentMap
+// не поддерживает, и сбор результата: BuildOrdinaryMap против ForEach
+const size_t OPERATION_COUNT = 4'000'000;
+const size_t KEY_COUNT = 100'000;
+const size_t BUCKET_COUNT = 1'000;
+
+template <typename Function>
+double MeasureSeconds(Function function) {
+    const auto start = chrono::steady_clock::now();
+    function();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Каждый поток выполняет свою долю операций над ключами из keys
+template <typename Key, typename Operation>
+double RunThreads(size_t thread_count, const vector<Key>& keys, Operation operation) {
+    return MeasureSeconds([&] {
+        vector<thread> threads;
+        for (size_t t = 0; t < thread_count; ++t) {
+            threads.emplace_back([&, t] {
+                const size_t operation_count = OPERATION_COUNT / thread_count;
+                for (size_t i = 0, k = t * 7919 % keys.size(); i < operation_count; ++i) {
+                    operation(keys[k]);
+                    k = k + 1 == keys.size() ? 0 : k + 1;
+                }
+            });
+        }
+        for (thread& thread : threads) {
+            thread.join();
+        }
+    });
+}
+
+void PrintRate(string_view mark, size_t thread_count, double seconds) {
+    cout << mark << ", "s << thread_count << " threads: "s << OPERATION_COUNT / seconds / 1e6 << " Mops/s"s << endl;
+}
+
+int main() {
+    mt19937 generator;
+    vector<int> int_keys(KEY_COUNT * 4);
+    uniform_int_distribution<int> key_distribution(0, KEY_COUNT - 1);
+    for (int& key : int_keys) {
+        key = key_distribution(generator);
+    }
+    const auto dictionary = GenerateDictionary(generator, KEY_COUNT / 10, 10);
+    const auto texts = GenerateQueries(generator, dictionary, KEY_COUNT / 25, 100);
+    vector<string_view> word_keys;
+    for (const string& text : texts) {
+        for (const string_view word : SplitIntoWords(text)) {
+            word_keys.push_back(word);
+        }
+    }
+
+    for (const size_t thread_count : {1, 2, 4, 8, 16, 32, 64}) {
+        ConcurrentMap<int, int64_t> bucket_map(BUCKET_COUNT);
+        PrintRate("ConcurrentMap<int>"s, thread_count, RunThreads(thread_count, int_keys, [&](int key) {
+            bucket_map[key].ref_to_value += 1;
+        }));
+        ConcurrentHashMap<int, int64_t> hash_map;
+        PrintRate("ConcurrentHashMap<int>"s, thread_count, RunThreads(thread_count, int_keys, [&](int key) {
+            hash_map.FetchAdd(key, 1);
+        }));
+        ConcurrentHashMap<string_view, int64_t> word_map;
+        PrintRate("ConcurrentHashMap<string_view>"s, thread_count, RunThreads(thread_count, word_keys,
+                                                                             [&](string_view key) {
+            word_map.FetchAdd(key, 1);
+        }));
+    }
+
+    ConcurrentMap<int, int64_t> bucket_map(BUCKET_COUNT);
+    ConcurrentHashMap<int, int64_t> hash_map;
+    for (const int key : int_keys) {
+        bucket_map[key].ref_to_value += 1;
+        hash_map.FetchAdd(key, 1);
+    }
+    int64_t bucket_total = 0;
+    const double build_seconds = MeasureSeconds([&] {
+        for (const auto& [key, value] : bucket_map.BuildOrdinaryMap()) {
+            bucket_total += value;
+        }
+    });
+    int64_t hash_total = 0;
+    const double for_each_seconds = MeasureSeconds([&] {
+        hash_map.ForEach([&hash_total](int, int64_t value) {
+            hash_total += value;
+        });
+    });
+    cout << "ConcurrentMap::BuildOrdinaryMap: "s << build_seconds * 1000 << " ms (total "s << bucket_total << ")"s
+         << endl;
+    cout << "ConcurrentHashMap::ForEach: "s << for_each_seconds * 1000 << " ms (total "s << hash_total << ")"s
+         << endl;
+}
@@ -0,0 +1,54 @@
+#include <chrono>
+#include <execution>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../generators.h"
+#include "../search_server.h"
+
+using namespace std;
+
+// Скорость индексации: по одному документу и пакетами, docs/s
+template <typename Function>
+void Measure(string_view mark, size_t document_count, Function function) {
+    const auto start = chrono::steady_clock::now();
+    function();
+    const chrono::duration<double> duration = chrono::steady_clock::now() - start;
+    cout << mark << ": "s << static_cast<size_t>(document_count / duration.count()) << " docs/s ("s
+         << chrono::duration_cast<chrono::milliseconds>(duration).count() << " ms)"s << endl;
+}
+
+int main() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+    const auto texts = GenerateQueries(generator, dictionary, 100'000, 100);
+
+    vector<NewDocument> batch;
+    batch.reserve(texts.size());
+    for (size_t i = 0; i < texts.size(); ++i) {
+        batch.push_back({static_cast<int>(i), texts[i], DocumentStatus::ACTUAL, {1, 2, 3}});
+    }
+
+    {
+        SearchServer search_server(dictionary[0]);
+        Measure("AddDocument"s, batch.size(), [&] {
+            for (const NewDocument& document : batch) {
+                search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+            }
+        });
+    }
+    {
+        SearchServer search_server(dictionary[0]);
+        Measure("AddDocuments(seq)"s, batch.size(), [&] {
+            search_server.AddDocuments(execution::seq, batch);
+        });
+    }
+    {
+        SearchServer search_server(dictionary[0]);
+        Measure("AddDocuments(par)"s, batch.size(), [&] {
+            search_server.AddDocuments(execution::par, batch);
+        });
+    }
+}
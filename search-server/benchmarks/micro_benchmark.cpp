@@ -0,0 +1,239 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <execution>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../generators.h"
+#include "../process_queries.h"
+#include "../remove_duplicates.h"
+#include "../search_server.h"
+
+using namespace std;
+
+// Микробенчмарки горячих операций сервера на корпусах разного размера.
+// Каждая строка вывода - отдельный JSON-объект: имя операции, параметры
+// случая, число операций, ns/op, операций в секунду и выделений памяти на
+// операцию. Выделения считает замена глобального operator new ниже
+
+namespace {
+
+atomic<size_t> allocation_count{0};
+
+} // namespace
+
+void* operator new(size_t size) {
+    allocation_count.fetch_add(1, memory_order_relaxed);
+    if (void* pointer = malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    operator delete(pointer);
+}
+
+namespace {
+
+// Не даёт компилятору выбросить результат измеряемой операции
+volatile size_t sink = 0;
+
+constexpr chrono::milliseconds MIN_MEASURE_TIME(200);
+
+// Параметры случая в виде продолжения JSON-объекта
+class Params {
+public:
+    template <typename Value>
+    Params& Add(string_view key, const Value& value) {
+        ostringstream text;
+        text << ",\""s << key << "\":"s;
+        if constexpr (is_convertible_v<Value, string_view>) {
+            text << '"' << value << '"';
+        } else {
+            text << value;
+        }
+        text_ += text.str();
+        return *this;
+    }
+
+    const string& ToString() const {
+        return text_;
+    }
+
+private:
+    string text_;
+};
+
+void Report(string_view name, const Params& params, size_t op_count, chrono::nanoseconds duration,
+            size_t allocations) {
+    const double ns_per_op = static_cast<double>(duration.count()) / op_count;
+    cout << "{\"name\":\""s << name << '"' << params.ToString()
+         << ",\"ops\":"s << op_count
+         << ",\"ns_per_op\":"s << ns_per_op
+         << ",\"ops_per_second\":"s << 1e9 / ns_per_op
+         << ",\"allocs_per_op\":"s << static_cast<double>(allocations) / op_count << '}' << endl;
+}
+
+// Выполняет operation(i) для i = 0, 1, ... ровно op_count раз
+template <typename Operation>
+void MeasureFixed(string_view name, const Params& params, size_t op_count, Operation operation) {
+    const size_t allocations_before = allocation_count.load();
+    const auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < op_count; ++i) {
+        operation(i);
+    }
+    const auto duration = chrono::steady_clock::now() - start;
+    Report(name, params, op_count, chrono::duration_cast<chrono::nanoseconds>(duration),
+           allocation_count.load() - allocations_before);
+}
+
+// Для операций без побочных эффектов: число повторов удваивается, пока
+// замер не займёт MIN_MEASURE_TIME
+template <typename Operation>
+void Measure(string_view name, const Params& params, Operation operation) {
+    for (size_t op_count = 1;; op_count *= 2) {
+        const size_t allocations_before = allocation_count.load();
+        const auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < op_count; ++i) {
+            operation(i);
+        }
+        const auto duration = chrono::steady_clock::now() - start;
+        if (duration >= MIN_MEASURE_TIME) {
+            Report(name, params, op_count, chrono::duration_cast<chrono::nanoseconds>(duration),
+                   allocation_count.load() - allocations_before);
+            return;
+        }
+    }
+}
+
+vector<string> GenerateMinusQueries(mt19937& generator, const vector<string>& dictionary, int query_count,
+                                    int word_count, double minus_prob) {
+    vector<string> queries;
+    queries.reserve(query_count);
+    for (int i = 0; i < query_count; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, word_count, minus_prob));
+    }
+    return queries;
+}
+
+void RunCorpus(mt19937& generator, const vector<string>& dictionary, int document_count) {
+    const auto texts = GenerateQueries(generator, dictionary, document_count, 50);
+    SearchServer search_server(dictionary[0]);
+    MeasureFixed("AddDocument"sv, Params().Add("documents"sv, document_count), texts.size(), [&](size_t i) {
+        search_server.AddDocument(static_cast<int>(i), texts[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    });
+
+    for (const int word_count : {1, 3, 7, 15}) {
+        for (const double minus_prob : {0.0, 0.3}) {
+            const auto queries = GenerateMinusQueries(generator, dictionary, 1'000, word_count, minus_prob);
+            const auto params = [&](string_view policy) {
+                return Params()
+                    .Add("policy"sv, policy)
+                    .Add("documents"sv, document_count)
+                    .Add("query_words"sv, word_count)
+                    .Add("minus_ratio"sv, minus_prob);
+            };
+            Measure("FindTopDocuments"sv, params("seq"sv), [&](size_t i) {
+                sink = sink + search_server.FindTopDocuments(execution::seq, queries[i % queries.size()]).size();
+            });
+            Measure("FindTopDocuments"sv, params("par"sv), [&](size_t i) {
+                sink = sink + search_server.FindTopDocuments(execution::par, queries[i % queries.size()]).size();
+            });
+        }
+    }
+
+    // статус и диапазон рейтинга сервер проверяет по битовым картам, а
+    // лямбду с тем же условием - вызовом на каждое вхождение
+    const auto filter_queries = GenerateMinusQueries(generator, dictionary, 1'000, 7, 0.0);
+    const auto filter_params = [&](string_view filter) {
+        return Params().Add("filter"sv, filter).Add("documents"sv, document_count).Add("query_words"sv, 7);
+    };
+    Measure("FindTopDocuments"sv, filter_params("status"sv), [&](size_t i) {
+        sink = sink + search_server.FindTopDocuments(filter_queries[i % filter_queries.size()],
+                                                     DocumentStatus::ACTUAL).size();
+    });
+    Measure("FindTopDocuments"sv, filter_params("lambda"sv), [&](size_t i) {
+        const auto predicate = [](int /*document_id*/, DocumentStatus status, int rating) {
+            return status == DocumentStatus::ACTUAL && rating >= 2;
+        };
+        sink = sink + search_server.FindTopDocuments(filter_queries[i % filter_queries.size()], predicate).size();
+    });
+    Measure("FindTopDocuments"sv, filter_params("status_rating"sv), [&](size_t i) {
+        sink = sink + search_server.FindTopDocuments(filter_queries[i % filter_queries.size()],
+                                                     DocumentFilter{DocumentStatus::ACTUAL, 2}).size();
+    });
+
+    const auto match_queries = GenerateMinusQueries(generator, dictionary, 1'000, 7, 0.1);
+    const auto random_id = [document_count](size_t i) {
+        return static_cast<int>(i * 7919 % document_count);
+    };
+    for (const string_view policy : {"seq"sv, "par"sv}) {
+        const auto params = Params().Add("policy"sv, policy).Add("documents"sv, document_count).Add("query_words"sv, 7);
+        Measure("MatchDocument"sv, params, [&](size_t i) {
+            const auto& query = match_queries[i % match_queries.size()];
+            const auto [words, status] = policy == "seq"sv
+                ? search_server.MatchDocument(execution::seq, query, random_id(i))
+                : search_server.MatchDocument(execution::par, query, random_id(i));
+            sink = sink + words.size();
+        });
+    }
+
+    Measure("GetWordFrequencies"sv, Params().Add("documents"sv, document_count), [&](size_t i) {
+        sink = sink + search_server.GetWordFrequencies(random_id(i)).size();
+    });
+
+    for (const double min_similarity : {1.0, 0.8}) {
+        Measure("FindDuplicateGroups"sv,
+                Params().Add("documents"sv, document_count).Add("min_similarity"sv, min_similarity), [&](size_t) {
+                    sink = sink + FindDuplicateGroups(search_server, min_similarity).size();
+                });
+    }
+
+    const auto batch = GenerateMinusQueries(generator, dictionary, 1'000, 7, 0.1);
+    Measure("ProcessQueries"sv, Params().Add("documents"sv, document_count).Add("batch"sv, batch.size()),
+            [&](size_t) {
+                sink = sink + ProcessQueries(search_server, batch).size();
+            });
+
+    // удаляются документы с разных концов индекса, чтобы seq и par не
+    // попадали в уже прореженную часть
+    const size_t remove_count = min(document_count / 4, 1'000);
+    MeasureFixed("RemoveDocument"sv, Params().Add("policy"sv, "seq"sv).Add("documents"sv, document_count),
+                 remove_count, [&](size_t i) {
+                     search_server.RemoveDocument(execution::seq, static_cast<int>(i * 2));
+                 });
+    MeasureFixed("RemoveDocument"sv, Params().Add("policy"sv, "par"sv).Add("documents"sv, document_count),
+                 remove_count, [&](size_t i) {
+                     search_server.RemoveDocument(execution::par, document_count - 1 - static_cast<int>(i * 2));
+                 });
+
+    search_server.SetRemovalMode(RemovalMode::DEFERRED);
+    MeasureFixed("RemoveDocument"sv, Params().Add("policy"sv, "deferred"sv).Add("documents"sv, document_count),
+                 remove_count, [&](size_t i) {
+                     search_server.RemoveDocument(static_cast<int>(i * 2 + 1));
+                 });
+    MeasureFixed("Compact"sv, Params().Add("documents"sv, document_count).Add("removed"sv, remove_count), 1,
+                 [&](size_t) {
+                     search_server.Compact(execution::par);
+                 });
+}
+
+} // namespace
+
+int main() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+    for (const int document_count : {1'000, 10'000, 50'000}) {
+        RunCorpus(generator, dictionary, document_count);
+    }
+}
@@ -0,0 +1,75 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../generators.h"
+#include "../process_queries.h"
+#include "../search_server.h"
+#include "../thread_pool.h"
+
+using namespace std;
+
+// Пропускная способность пакетной обработки запросов (queries/s): std::transform(par)
+// и список против пула потоков с плоским обходом результатов и против общего
+// обхода списков вхождений. Для общего обхода печатается, сколько вхождений
+// он не обходил повторно
+template <typename Function>
+void Measure(string_view mark, size_t batch_size, size_t repeat_count, Function function) {
+    size_t document_count = 0;
+    const auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < repeat_count; ++i) {
+        document_count += function();
+    }
+    const chrono::duration<double> duration = chrono::steady_clock::now() - start;
+    cout << "batch "s << batch_size << ", "s << mark << ": "s
+         << static_cast<size_t>(batch_size * repeat_count / duration.count()) << " queries/s ("s
+         << document_count << " documents)"s << endl;
+}
+
+int main() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 10'000, 25);
+    const auto documents = GenerateQueries(generator, dictionary, 20'000, 10);
+    const auto queries = GenerateQueries(generator, dictionary, 10'000, 7);
+
+    SearchServer search_server(dictionary[0]);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+
+    ThreadPool thread_pool;
+    for (const size_t batch_size : {10, 100, 1'000, 10'000}) {
+        const vector<string> batch(queries.begin(), queries.begin() + batch_size);
+        const size_t repeat_count = 10'000 / batch_size;
+
+        Measure("ProcessQueriesJoined(list)"s, batch_size, repeat_count, [&] {
+            size_t count = 0;
+            for (const Document& document : ProcessQueriesJoined(search_server, batch)) {
+                count += document.id >= 0;
+            }
+            return count;
+        });
+        Measure("ProcessQueriesJoined(pool)"s, batch_size, repeat_count, [&] {
+            size_t count = 0;
+            for (const Document& document : ProcessQueriesJoined(thread_pool, search_server, batch)) {
+                count += document.id >= 0;
+            }
+            return count;
+        });
+        Measure("ProcessQueriesShared"s, batch_size, repeat_count, [&] {
+            size_t count = 0;
+            for (const auto& query_documents : ProcessQueriesShared(search_server, batch)) {
+                count += query_documents.size();
+            }
+            return count;
+        });
+    }
+
+    search_server.EnableMetrics(true);
+    ProcessQueriesShared(search_server, queries);
+    const SearchMetricsSnapshot metrics = search_server.GetMetricsSnapshot();
+    cout << "shared scan of "s << queries.size() << " queries: "s << metrics.postings_scanned
+         << " postings scanned, "s << metrics.postings_shared << " scans saved"s << endl;
+}
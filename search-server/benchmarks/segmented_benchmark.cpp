@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../concurrent_search_server.h"
+#include "../generators.h"
+#include "../segmented_search_server.h"
+
+using namespace std;
+
+// Устойчивая скорость индексации под поисковой нагрузкой: писатель
+// непрерывно добавляет новые документы, пока несколько потоков ищут.
+// Скорость записи печатается по секундам, чтобы было видно, падает ли она
+// с ростом индекса
+template <typename Server>
+void Run(string_view mark, Server& search_server, const vector<string>& texts, const vector<string>& queries,
+         size_t reader_count, int seconds) {
+    atomic<bool> stop = false;
+    atomic<size_t> query_count = 0;
+    vector<thread> readers;
+    for (size_t r = 0; r < reader_count; ++r) {
+        readers.emplace_back([&, r] {
+            size_t local_count = 0;
+            for (size_t i = r; !stop; i = (i + reader_count) % queries.size()) {
+                search_server.FindTopDocuments(queries[i]);
+                ++local_count;
+            }
+            query_count += local_count;
+        });
+    }
+
+    vector<size_t> writes_per_second;
+    int next_id = 0;
+    for (int second = 0; second < seconds; ++second) {
+        const auto deadline = chrono::steady_clock::now() + chrono::seconds(1);
+        const int first_id = next_id;
+        while (chrono::steady_clock::now() < deadline) {
+            search_server.AddDocument(next_id, texts[next_id % texts.size()], DocumentStatus::ACTUAL, {1, 2, 3});
+            ++next_id;
+        }
+        writes_per_second.push_back(next_id - first_id);
+    }
+    stop = true;
+    for (thread& reader : readers) {
+        reader.join();
+    }
+
+    cout << mark << ": "s << next_id << " docs, "s << query_count / seconds << " queries/s, docs/s by second:"s;
+    for (const size_t writes : writes_per_second) {
+        cout << ' ' << writes;
+    }
+    cout << endl;
+}
+
+int main() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 5'000, 10);
+    const auto texts = GenerateQueries(generator, dictionary, 50'000, 50);
+    const auto queries = GenerateQueries(generator, dictionary, 1'000, 5);
+    const size_t reader_count = max(2u, thread::hardware_concurrency() / 2);
+    const int seconds = 5;
+
+    {
+        ConcurrentSearchServer search_server(dictionary[0]);
+        Run("ConcurrentSearchServer"s, search_server, texts, queries, reader_count, seconds);
+    }
+    {
+        SegmentedSearchServer search_server(dictionary[0]);
+        Run("SegmentedSearchServer"s, search_server, texts, queries, reader_count, seconds);
+        search_server.WaitForMerges();
+        cout << "segments after merges: "s << search_server.GetSegmentCount() << endl;
+    }
+}
@@ -0,0 +1,97 @@
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../generators.h"
+#include "../search_server.h"
+#include "../write_ahead_log.h"
+
+using namespace std;
+
+// Цена журнала на записи (ops/s без журнала и с разной групповой
+// фиксацией) и время восстановления из снимка и журнала по сравнению с
+// повторной индексацией всего корпуса
+const string LOG_PATH = "wal_benchmark.log"s;
+const string SNAPSHOT_PATH = "wal_benchmark.snapshot"s;
+
+template <typename Function>
+double MeasureSeconds(Function function) {
+    const auto start = chrono::steady_clock::now();
+    function();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void MeasureWrites(string_view mark, const vector<string>& texts, size_t document_count,
+                   const WriteAheadLogOptions* options) {
+    remove(LOG_PATH.c_str());
+    SearchServer search_server(""s);
+    unique_ptr<WriteAheadLog> log;
+    if (options != nullptr) {
+        log = make_unique<WriteAheadLog>(LOG_PATH, *options);
+        search_server.SetWriteAheadLog(log.get());
+    }
+    const double seconds = MeasureSeconds([&] {
+        for (size_t i = 0; i < document_count; ++i) {
+            search_server.AddDocument(static_cast<int>(i), texts[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        if (log) {
+            log->Flush();
+        }
+    });
+    cout << mark << ": "s << static_cast<size_t>(document_count / seconds) << " ops/s"s << endl;
+}
+
+int main() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+    const auto texts = GenerateQueries(generator, dictionary, 100'000, 100);
+
+    MeasureWrites("no log"s, texts, texts.size(), nullptr);
+    const WriteAheadLogOptions no_sync{1, false};
+    MeasureWrites("log, write per op, no fsync"s, texts, texts.size(), &no_sync);
+    const WriteAheadLogOptions group_sync{256, true};
+    MeasureWrites("log, fsync per 256 ops"s, texts, texts.size(), &group_sync);
+    // fsync на каждую запись упирается в диск, поэтому документов меньше
+    const WriteAheadLogOptions every_sync{1, true};
+    MeasureWrites("log, fsync per op"s, texts, 2'000, &every_sync);
+
+    // Снимок покрывает 80% корпуса, остальное и удаления - в журнале
+    remove(LOG_PATH.c_str());
+    const size_t snapshot_count = texts.size() * 4 / 5;
+    {
+        SearchServer search_server(""s);
+        WriteAheadLog log(LOG_PATH, no_sync);
+        search_server.SetWriteAheadLog(&log);
+        for (size_t i = 0; i < snapshot_count; ++i) {
+            search_server.AddDocument(static_cast<int>(i), texts[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        search_server.SaveSnapshot(SNAPSHOT_PATH);
+        log.Truncate();
+        for (size_t i = snapshot_count; i < texts.size(); ++i) {
+            search_server.AddDocument(static_cast<int>(i), texts[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        for (size_t i = 0; i < texts.size(); i += 10) {
+            search_server.RemoveDocument(static_cast<int>(i));
+        }
+    }
+
+    int recovered_count = 0;
+    const double recovery_seconds = MeasureSeconds([&] {
+        recovered_count = RecoverSearchServer(SNAPSHOT_PATH, LOG_PATH).GetDocumentCount();
+    });
+    const double reindex_seconds = MeasureSeconds([&] {
+        SearchServer search_server(""s);
+        for (size_t i = 0; i < texts.size(); ++i) {
+            search_server.AddDocument(static_cast<int>(i), texts[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+    });
+    cout << "recovery from snapshot + log: "s << static_cast<int>(recovery_seconds * 1000) << " ms ("s
+         << recovered_count << " docs)"s << endl;
+    cout << "reindexing the corpus: "s << static_cast<int>(reindex_seconds * 1000) << " ms"s << endl;
+
+    remove(LOG_PATH.c_str());
+    remove(SNAPSHOT_PATH.c_str());
+}
@@ -0,0 +1,39 @@
+#include "collection_statistics.h"
+
+#include <cmath>
+
+using namespace std;
+
+void CollectionStatistics::AddDocument(const map<string_view, double>& word_freqs) {
+    for (const auto& [word, freq] : word_freqs) {
+        const TermId term = terms_.Intern(word);
+        if (term == document_freqs_.size()) {
+            document_freqs_.push_back(0);
+        }
+        ++document_freqs_[term];
+    }
+    ++document_count_;
+    ++generation_;
+}
+
+void CollectionStatistics::RemoveDocument(const map<string_view, double>& word_freqs) {
+    for (const auto& [word, freq] : word_freqs) {
+        --document_freqs_[terms_.Find(word)];
+    }
+    --document_count_;
+    ++generation_;
+}
+
+int CollectionStatistics::GetDocumentFreq(string_view word) const {
+    const TermId term = terms_.Find(word);
+    return term == TermDictionary::NO_TERM ? 0 : document_freqs_[term];
+}
+
+string_view CollectionStatistics::FindWord(string_view word) const {
+    const TermId term = terms_.Find(word);
+    return term == TermDictionary::NO_TERM ? string_view{} : terms_.GetTerm(term);
+}
+
+double CollectionStatistics::ComputeInverseDocumentFreq(string_view word) const {
+    return log(document_count_ * 1.0 / GetDocumentFreq(word));
+}
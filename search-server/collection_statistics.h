@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string_view>
+#include <vector>
+
+#include "term_dictionary.h"
+
+// Документные частоты слов по всей коллекции. Несколько индексов, каждый из
+// которых хранит часть документов, считают по ним общий IDF
+class CollectionStatistics {
+public:
+    void AddDocument(const std::map<std::string_view, double>& word_freqs);
+    void RemoveDocument(const std::map<std::string_view, double>& word_freqs);
+
+    int GetDocumentCount() const {
+        return document_count_;
+    }
+    // Растёт при каждом изменении статистики
+    uint64_t GetGeneration() const {
+        return generation_;
+    }
+    int GetDocumentFreq(std::string_view word) const;
+    // То же слово из словаря статистики: строка живёт, пока жива статистика.
+    // Пустая строка, если слово ни разу не встречалось
+    std::string_view FindWord(std::string_view word) const;
+    double ComputeInverseDocumentFreq(std::string_view word) const;
+
+private:
+    TermDictionary terms_;
+    std::vector<int> document_freqs_;
+    int document_count_ = 0;
+    uint64_t generation_ = 0;
+};
@@ -0,0 +1,378 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+
+// Хеш-таблица с открытой адресацией и линейным пробированием, которую
+// потоки обновляют без блокировок: значения атомарные, а ключ занимает
+// ячейку одним CAS по её метке. Ключи - любые хешируемые и копируемые
+// (string_view тоже: строки должны пережить карту), значения - числа,
+// которые меняются через FetchAdd и Store. Ключи не удаляются, кроме как
+// все сразу через Drain.
+//
+// Расширение таблицы - единственная операция, которая ждёт остальные:
+// каждая операция отмечается в счётчике своей полосы, и расширяющий поток
+// дожидается, пока все полосы опустеют. Полос много и каждая в своей линии
+// кеша, поэтому в обычной работе потоки не делят ни одной записываемой
+// линии, кроме ячеек таблицы и счётчика размера при вставке новых ключей
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class ConcurrentHashMap {
+public:
+    static_assert(std::is_arithmetic_v<Value>, "ConcurrentHashMap values must be arithmetic");
+    static_assert(std::is_default_constructible_v<Key> && std::is_copy_assignable_v<Key>,
+                  "ConcurrentHashMap keys must be default constructible and copy assignable");
+
+    explicit ConcurrentHashMap(size_t capacity = 64)
+        : table_(std::make_unique<Table>(RoundUpCapacity(capacity))) {
+    }
+
+    ConcurrentHashMap(const ConcurrentHashMap&) = delete;
+    ConcurrentHashMap& operator=(const ConcurrentHashMap&) = delete;
+
+    // Прибавляет delta к значению ключа (новый ключ начинается с нуля) и
+    // возвращает значение до прибавления
+    Value FetchAdd(const Key& key, Value delta);
+    void Store(const Key& key, Value value);
+    std::optional<Value> Find(const Key& key) const;
+
+    size_t size() const {
+        return size_.load(std::memory_order_relaxed);
+    }
+    size_t GetCapacity() const;
+
+    // Вызывает function(const Key&, Value) для каждого ключа, ничего не
+    // копируя. Одновременные обновления допустимы: значение может оказаться
+    // и до, и после них. function не должна менять карту
+    template <typename Function>
+    void ForEach(Function function) const;
+    // Отдаёт все пары function(const Key&, Value) и очищает карту, не
+    // отдавая память таблицы. Одновременные операции ждут окончания
+    template <typename Function>
+    void Drain(Function function);
+
+    std::map<Key, Value> BuildOrdinaryMap() const;
+
+private:
+    // метка ячейки: свободна, занята пишущим ключ потоком или хранит
+    // старшие биты хеша ключа (всегда не меньше READY_TAG)
+    static constexpr uint32_t EMPTY_TAG = 0;
+    static constexpr uint32_t BUSY_TAG = 1;
+    static constexpr uint32_t READY_TAG = 2;
+    // таблица расширяется вдвое, когда занято больше 3/4 ячеек
+    static constexpr size_t MAX_LOAD_NUMERATOR = 3;
+    static constexpr size_t MAX_LOAD_DENOMINATOR = 4;
+    static constexpr size_t STRIPE_COUNT = 64;
+
+    struct Slot {
+        std::atomic<uint32_t> tag{EMPTY_TAG};
+        Key key{};
+        std::atomic<Value> value{};
+    };
+
+    struct Table {
+        explicit Table(size_t capacity)
+            : mask(capacity - 1)
+            , slots(std::make_unique<Slot[]>(capacity)) {
+        }
+
+        size_t mask;
+        std::unique_ptr<Slot[]> slots;
+    };
+
+    struct alignas(64) Stripe {
+        std::atomic<size_t> active{0};
+    };
+
+    // Отмечает операцию в полосе текущего потока на время своей жизни.
+    // Пока идёт расширение, ждёт его окончания
+    class OperationGuard {
+    public:
+        explicit OperationGuard(const ConcurrentHashMap& map);
+        ~OperationGuard() {
+            stripe_.active.fetch_sub(1, std::memory_order_release);
+        }
+
+        OperationGuard(const OperationGuard&) = delete;
+        OperationGuard& operator=(const OperationGuard&) = delete;
+
+    private:
+        Stripe& stripe_;
+    };
+
+    // Пока жив, операции не идут и таблицу можно менять целиком
+    class ExclusiveGuard {
+    public:
+        explicit ExclusiveGuard(const ConcurrentHashMap& map);
+        ~ExclusiveGuard() {
+            map_.exclusive_.store(false, std::memory_order_seq_cst);
+        }
+
+        ExclusiveGuard(const ExclusiveGuard&) = delete;
+        ExclusiveGuard& operator=(const ExclusiveGuard&) = delete;
+
+    private:
+        const ConcurrentHashMap& map_;
+        std::lock_guard<std::mutex> guard_;
+    };
+
+    std::unique_ptr<Table> table_;
+    std::atomic<size_t> size_{0};
+    mutable std::array<Stripe, STRIPE_COUNT> stripes_;
+    mutable std::atomic<bool> exclusive_{false};
+    // расширяющие и очищающие потоки выстраиваются в очередь
+    mutable std::mutex exclusive_mutex_;
+
+    static size_t RoundUpCapacity(size_t capacity);
+    static Stripe& GetStripe(const ConcurrentHashMap& map);
+    static uint64_t MixHash(uint64_t hash);
+    static uint32_t GetTag(uint64_t hash) {
+        return std::max(static_cast<uint32_t>(hash >> 32), READY_TAG);
+    }
+
+    // Ячейка ключа или nullptr, если ключа нет. При insert ключ
+    // добавляется; nullptr тогда значит, что таблица заполнена
+    Slot* FindSlot(const Table& table, const Key& key, uint64_t hash, bool insert);
+    const Slot* FindSlot(const Table& table, const Key& key, uint64_t hash) const;
+    // Ячейка ключа, при необходимости добавленного; расширяет таблицу, если
+    // она переполнена. Вызывающий сам отмечается в полосе через guard
+    template <typename Function>
+    Value UpdateSlot(const Key& key, Function update);
+    void Grow(const Table* observed_table);
+};
+
+//          TEMPLATE FUNCTIONS REALIZATION
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+ConcurrentHashMap<Key, Value, Hash, KeyEqual>::OperationGuard::OperationGuard(const ConcurrentHashMap& map)
+    : stripe_(GetStripe(map)) {
+    while (true) {
+        // seq_cst в паре с ExclusiveGuard: либо операция увидит флаг, либо
+        // расширяющий поток увидит её в полосе
+        stripe_.active.fetch_add(1, std::memory_order_seq_cst);
+        if (!map.exclusive_.load(std::memory_order_seq_cst)) {
+            return;
+        }
+        stripe_.active.fetch_sub(1, std::memory_order_release);
+        while (map.exclusive_.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+ConcurrentHashMap<Key, Value, Hash, KeyEqual>::ExclusiveGuard::ExclusiveGuard(const ConcurrentHashMap& map)
+    : map_(map)
+    , guard_(map.exclusive_mutex_) {
+    map_.exclusive_.store(true, std::memory_order_seq_cst);
+    for (const Stripe& stripe : map_.stripes_) {
+        while (stripe.active.load(std::memory_order_seq_cst) != 0) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+Value ConcurrentHashMap<Key, Value, Hash, KeyEqual>::FetchAdd(const Key& key, Value delta) {
+    return UpdateSlot(key, [delta](std::atomic<Value>& value) {
+        if constexpr (std::is_integral_v<Value>) {
+            return value.fetch_add(delta, std::memory_order_relaxed);
+        } else {
+            // fetch_add для чисел с плавающей точкой появился только в C++20
+            Value expected = value.load(std::memory_order_relaxed);
+            while (!value.compare_exchange_weak(expected, expected + delta, std::memory_order_relaxed)) {
+            }
+            return expected;
+        }
+    });
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+void ConcurrentHashMap<Key, Value, Hash, KeyEqual>::Store(const Key& key, Value value) {
+    UpdateSlot(key, [value](std::atomic<Value>& slot_value) {
+        return slot_value.exchange(value, std::memory_order_relaxed);
+    });
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+std::optional<Value> ConcurrentHashMap<Key, Value, Hash, KeyEqual>::Find(const Key& key) const {
+    const uint64_t hash = MixHash(Hash{}(key));
+    OperationGuard guard(*this);
+    const Slot* slot = FindSlot(*table_, key, hash);
+    if (slot == nullptr) {
+        return std::nullopt;
+    }
+    return slot->value.load(std::memory_order_relaxed);
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+size_t ConcurrentHashMap<Key, Value, Hash, KeyEqual>::GetCapacity() const {
+    OperationGuard guard(*this);
+    return table_->mask + 1;
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+template <typename Function>
+void ConcurrentHashMap<Key, Value, Hash, KeyEqual>::ForEach(Function function) const {
+    OperationGuard guard(*this);
+    const Table& table = *table_;
+    for (size_t i = 0; i <= table.mask; ++i) {
+        const Slot& slot = table.slots[i];
+        if (slot.tag.load(std::memory_order_acquire) >= READY_TAG) {
+            function(static_cast<const Key&>(slot.key), slot.value.load(std::memory_order_relaxed));
+        }
+    }
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+template <typename Function>
+void ConcurrentHashMap<Key, Value, Hash, KeyEqual>::Drain(Function function) {
+    ExclusiveGuard guard(*this);
+    Table& table = *table_;
+    for (size_t i = 0; i <= table.mask; ++i) {
+        Slot& slot = table.slots[i];
+        if (slot.tag.load(std::memory_order_relaxed) >= READY_TAG) {
+            function(static_cast<const Key&>(slot.key), slot.value.load(std::memory_order_relaxed));
+            slot.key = Key{};
+            slot.value.store(Value{}, std::memory_order_relaxed);
+            slot.tag.store(EMPTY_TAG, std::memory_order_relaxed);
+        }
+    }
+    size_.store(0, std::memory_order_relaxed);
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+std::map<Key, Value> ConcurrentHashMap<Key, Value, Hash, KeyEqual>::BuildOrdinaryMap() const {
+    std::map<Key, Value> result;
+    ForEach([&result](const Key& key, Value value) {
+        result.emplace(key, value);
+    });
+    return result;
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+size_t ConcurrentHashMap<Key, Value, Hash, KeyEqual>::RoundUpCapacity(size_t capacity) {
+    size_t result = 8;
+    while (result < capacity) {
+        result *= 2;
+    }
+    return result;
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+typename ConcurrentHashMap<Key, Value, Hash, KeyEqual>::Stripe&
+ConcurrentHashMap<Key, Value, Hash, KeyEqual>::GetStripe(const ConcurrentHashMap& map) {
+    // потоки получают полосы по кругу при первом обращении к любой карте
+    static std::atomic<size_t> next_stripe{0};
+    thread_local const size_t stripe = next_stripe.fetch_add(1, std::memory_order_relaxed) % STRIPE_COUNT;
+    return map.stripes_[stripe];
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+uint64_t ConcurrentHashMap<Key, Value, Hash, KeyEqual>::MixHash(uint64_t hash) {
+    // std::hash для целых - тождество, а ячейка выбирается по младшим
+    // битам: перемешивание (финализатор MurmurHash3) разносит ключи с общим
+    // шагом по разным ячейкам
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+typename ConcurrentHashMap<Key, Value, Hash, KeyEqual>::Slot*
+ConcurrentHashMap<Key, Value, Hash, KeyEqual>::FindSlot(const Table& table, const Key& key, uint64_t hash,
+                                                        bool insert) {
+    const uint32_t tag = GetTag(hash);
+    size_t index = hash & table.mask;
+    for (size_t probe = 0; probe <= table.mask; ++probe, index = (index + 1) & table.mask) {
+        Slot& slot = table.slots[index];
+        uint32_t slot_tag = slot.tag.load(std::memory_order_acquire);
+        if (slot_tag == EMPTY_TAG) {
+            if (!insert) {
+                return nullptr;
+            }
+            if (slot.tag.compare_exchange_strong(slot_tag, BUSY_TAG, std::memory_order_acquire)) {
+                slot.key = key;
+                slot.tag.store(tag, std::memory_order_release);
+                size_.fetch_add(1, std::memory_order_relaxed);
+                return &slot;
+            }
+            // ячейку занял другой поток, slot_tag - её новая метка
+        }
+        // ключ в ячейку дописывается за несколько тактов, ждать недолго
+        while (slot_tag == BUSY_TAG) {
+            slot_tag = slot.tag.load(std::memory_order_acquire);
+        }
+        if (slot_tag == tag && KeyEqual{}(slot.key, key)) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+const typename ConcurrentHashMap<Key, Value, Hash, KeyEqual>::Slot*
+ConcurrentHashMap<Key, Value, Hash, KeyEqual>::FindSlot(const Table& table, const Key& key, uint64_t hash) const {
+    return const_cast<ConcurrentHashMap&>(*this).FindSlot(table, key, hash, false);
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+template <typename Function>
+Value ConcurrentHashMap<Key, Value, Hash, KeyEqual>::UpdateSlot(const Key& key, Function update) {
+    const uint64_t hash = MixHash(Hash{}(key));
+    while (true) {
+        const Table* observed_table = nullptr;
+        {
+            OperationGuard guard(*this);
+            observed_table = table_.get();
+            const size_t capacity = observed_table->mask + 1;
+            if (size_.load(std::memory_order_relaxed) * MAX_LOAD_DENOMINATOR < capacity * MAX_LOAD_NUMERATOR) {
+                if (Slot* slot = FindSlot(*observed_table, key, hash, true)) {
+                    return update(slot->value);
+                }
+            } else if (Slot* slot = FindSlot(*observed_table, key, hash, false)) {
+                // существующий ключ обновляется и в переполненной таблице
+                return update(slot->value);
+            }
+        }
+        Grow(observed_table);
+    }
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+void ConcurrentHashMap<Key, Value, Hash, KeyEqual>::Grow(const Table* observed_table) {
+    ExclusiveGuard guard(*this);
+    // таблицу мог уже расширить другой поток
+    if (table_.get() != observed_table) {
+        return;
+    }
+    auto table = std::make_unique<Table>((table_->mask + 1) * 2);
+    for (size_t i = 0; i <= table_->mask; ++i) {
+        const Slot& slot = table_->slots[i];
+        const uint32_t tag = slot.tag.load(std::memory_order_relaxed);
+        if (tag < READY_TAG) {
+            continue;
+        }
+        size_t index = MixHash(Hash{}(slot.key)) & table->mask;
+        while (table->slots[index].tag.load(std::memory_order_relaxed) != EMPTY_TAG) {
+            index = (index + 1) & table->mask;
+        }
+        Slot& new_slot = table->slots[index];
+        new_slot.key = slot.key;
+        new_slot.value.store(slot.value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        new_slot.tag.store(tag, std::memory_order_relaxed);
+    }
+    table_ = std::move(table);
+}
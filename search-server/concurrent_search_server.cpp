@@ -0,0 +1,148 @@
+#include "concurrent_search_server.h"
+
+#include <functional>
+#include <thread>
+
+using namespace std;
+
+ConcurrentSearchServer::ConcurrentSearchServer(const string& stop_words_text)
+    : ConcurrentSearchServer(SplitIntoWords(stop_words_text))
+{
+}
+
+ConcurrentSearchServer::~ConcurrentSearchServer() {
+    {
+        lock_guard guard(compactor_mutex_);
+        stopping_ = true;
+    }
+    compactor_cv_.notify_one();
+    if (compactor_.joinable()) {
+        compactor_.join();
+    }
+}
+
+ConcurrentSearchServer::ReadGuard::ReadGuard(const ConcurrentSearchServer& server)
+    : server_(server)
+    , slot_(GetReaderSlot()) {
+    // Писатель сначала переключает активную копию, а потом ждёт её
+    // читателей. Поэтому после регистрации нужно убедиться, что копия всё
+    // ещё активна: иначе писатель мог не увидеть этого читателя
+    while (true) {
+        instance_ = server_.active_.load();
+        server_.readers_[instance_][slot_].count.fetch_add(1);
+        if (server_.active_.load() == instance_) {
+            break;
+        }
+        server_.readers_[instance_][slot_].count.fetch_sub(1);
+    }
+}
+
+ConcurrentSearchServer::ReadGuard::~ReadGuard() {
+    server_.readers_[instance_][slot_].count.fetch_sub(1, memory_order_release);
+}
+
+vector<Document> ConcurrentSearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status,
+                                                          size_t max_document_count) const {
+    const ReadGuard search_server(*this);
+    return search_server->FindTopDocuments(raw_query, status, max_document_count);
+}
+
+vector<Document> ConcurrentSearchServer::FindTopDocuments(string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+SearchServer::matched_tuple ConcurrentSearchServer::MatchDocument(string_view raw_query, int document_id) const {
+    const ReadGuard search_server(*this);
+    return search_server->MatchDocument(raw_query, document_id);
+}
+
+int ConcurrentSearchServer::GetDocumentCount() const {
+    const ReadGuard search_server(*this);
+    return search_server->GetDocumentCount();
+}
+
+void ConcurrentSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status,
+                                         const vector<int>& ratings) {
+    Write([&](SearchServer& search_server) {
+        search_server.AddDocument(document_id, document, status, ratings);
+    });
+}
+
+void ConcurrentSearchServer::AddDocuments(const execution::parallel_policy& policy, const vector<NewDocument>& documents) {
+    Write([&](SearchServer& search_server) {
+        search_server.AddDocuments(policy, documents);
+    });
+}
+
+void ConcurrentSearchServer::RemoveDocument(int document_id) {
+    bool compaction_due = false;
+    Write([document_id, &compaction_due](SearchServer& search_server) {
+        search_server.RemoveDocument(document_id);
+        compaction_due = search_server.IsCompactionDue();
+    });
+
+    if (compaction_due) {
+        {
+            lock_guard guard(compactor_mutex_);
+            compaction_requested_ = true;
+        }
+        compactor_cv_.notify_one();
+    }
+}
+
+void ConcurrentSearchServer::EnableQueryCache(size_t max_size) {
+    Write([max_size](SearchServer& search_server) {
+        search_server.EnableQueryCache(max_size);
+    });
+}
+
+void ConcurrentSearchServer::SetCompactionThreshold(double removed_ratio) {
+    Write([removed_ratio](SearchServer& search_server) {
+        search_server.SetRemovalMode(RemovalMode::DEFERRED);
+        search_server.SetCompactionThreshold(removed_ratio);
+    });
+
+    lock_guard guard(compactor_mutex_);
+    if (!compactor_.joinable()) {
+        compactor_ = thread([this] {
+            RunCompactor();
+        });
+    }
+}
+
+void ConcurrentSearchServer::Compact() {
+    Write([](SearchServer& search_server) {
+        search_server.Compact(execution::par);
+    });
+}
+
+void ConcurrentSearchServer::RunCompactor() {
+    unique_lock lock(compactor_mutex_);
+    while (true) {
+        compactor_cv_.wait(lock, [this] {
+            return compaction_requested_ || stopping_;
+        });
+        if (stopping_) {
+            return;
+        }
+        compaction_requested_ = false;
+        lock.unlock();
+        Compact();
+        lock.lock();
+    }
+}
+
+size_t ConcurrentSearchServer::GetReaderSlot() {
+    thread_local const size_t slot = hash<thread::id>{}(this_thread::get_id()) % READER_SLOT_COUNT;
+    return slot;
+}
+
+void ConcurrentSearchServer::WaitForReaders(size_t instance) const {
+    for (const ReaderSlot& slot : readers_[instance]) {
+        // последовательная согласованность нужна, чтобы это чтение не
+        // обогнало переключение active_
+        while (slot.count.load() != 0) {
+            this_thread::yield();
+        }
+    }
+}
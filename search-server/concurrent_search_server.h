@@ -0,0 +1,136 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <execution>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+// Поисковый сервер, который можно менять, не останавливая поиск.
+//
+// Хранит две копии индекса. Читатели работают с активной копией и никогда
+// не ждут: вход в неё - пара атомарных операций. Единственный писатель
+// применяет изменение к неактивной копии, атомарно делает её активной,
+// дожидается, пока из старой копии выйдут все читатели, и повторяет
+// изменение на ней. Так запрос всегда видит неизменяемый снимок индекса,
+// а цена - вдвое больше памяти и двойная работа на запись
+class ConcurrentSearchServer {
+public:
+    template <typename StringContainer>
+    explicit ConcurrentSearchServer(const StringContainer& stop_words);
+    explicit ConcurrentSearchServer(const std::string& stop_words_text);
+
+    ConcurrentSearchServer(const ConcurrentSearchServer&) = delete;
+    ConcurrentSearchServer& operator=(const ConcurrentSearchServer&) = delete;
+    ~ConcurrentSearchServer();
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                           size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    // Слова результата указывают в словарь индекса и остаются валидными,
+    // пока жив сервер: термы из словаря не удаляются
+    SearchServer::matched_tuple MatchDocument(std::string_view raw_query, int document_id) const;
+    int GetDocumentCount() const;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void AddDocuments(const std::execution::parallel_policy& policy, const std::vector<NewDocument>& documents);
+    void RemoveDocument(int document_id);
+
+    void EnableQueryCache(size_t max_size);
+
+    // Переводит удаление в отложенный режим: RemoveDocument только помечает
+    // документ, а когда доля помеченных достигает removed_ratio, фоновый
+    // поток вычищает их из индекса. Поиск во время сжатия не ждёт, ждут
+    // только другие писатели. Ноль выключает фоновое сжатие
+    void SetCompactionThreshold(double removed_ratio);
+    void Compact();
+
+private:
+    static constexpr size_t READER_SLOT_COUNT = 64;
+
+    // счётчики читателей разнесены по кеш-линиям, чтобы потоки, входящие
+    // в одну копию, не конкурировали за одну переменную
+    struct alignas(64) ReaderSlot {
+        std::atomic<int64_t> count{0};
+    };
+
+    class ReadGuard {
+    public:
+        explicit ReadGuard(const ConcurrentSearchServer& server);
+        ~ReadGuard();
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+        const SearchServer& operator*() const {
+            return server_.instances_[instance_];
+        }
+        const SearchServer* operator->() const {
+            return &server_.instances_[instance_];
+        }
+
+    private:
+        const ConcurrentSearchServer& server_;
+        size_t instance_;
+        size_t slot_;
+    };
+
+    std::array<SearchServer, 2> instances_;
+    std::atomic<size_t> active_{0};
+    mutable std::array<std::array<ReaderSlot, READER_SLOT_COUNT>, 2> readers_;
+    std::mutex writer_mutex_;
+
+    std::mutex compactor_mutex_;
+    std::condition_variable compactor_cv_;
+    bool compaction_requested_ = false;
+    bool stopping_ = false;
+    std::thread compactor_;
+
+    static size_t GetReaderSlot();
+    void WaitForReaders(size_t instance) const;
+    void RunCompactor();
+
+    // Применяет изменение к обеим копиям; вызывается под writer_mutex_
+    template <typename Mutation>
+    void Write(Mutation mutation);
+};
+
+//          TEMPLATE FUNCTIONS REALIZATION
+
+template <typename StringContainer>
+ConcurrentSearchServer::ConcurrentSearchServer(const StringContainer& stop_words)
+    : instances_{SearchServer(stop_words), SearchServer(stop_words)} {
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> ConcurrentSearchServer::FindTopDocuments(std::string_view raw_query,
+                                                               DocumentPredicate document_predicate,
+                                                               size_t max_document_count) const {
+    const ReadGuard search_server(*this);
+    return search_server->FindTopDocuments(raw_query, document_predicate, max_document_count);
+}
+
+template <typename Mutation>
+void ConcurrentSearchServer::Write(Mutation mutation) {
+    std::lock_guard guard(writer_mutex_);
+    const size_t old_active = active_.load();
+    const size_t next_active = 1 - old_active;
+    // если изменение отвергнуто (исключение), копии остаются одинаковыми
+    mutation(instances_[next_active]);
+    active_.store(next_active);
+    WaitForReaders(old_active);
+    mutation(instances_[old_active]);
+}
@@ -0,0 +1,40 @@
+#include "document_filter.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+uint64_t GetOutOfRangeMaskScalar(const int* ratings, size_t count, int min_rating, int max_rating) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < count; ++i) {
+        mask |= static_cast<uint64_t>(ratings[i] < min_rating || ratings[i] > max_rating) << i;
+    }
+    return mask;
+}
+
+} // namespace
+
+void FilterRatingRange(const int* ratings, size_t count, int min_rating, int max_rating, uint64_t* bits) {
+    size_t word = 0;
+#ifdef __SSE2__
+    const __m128i min_ratings = _mm_set1_epi32(min_rating);
+    const __m128i max_ratings = _mm_set1_epi32(max_rating);
+    for (; (word + 1) * 64 <= count; ++word) {
+        const int* block = ratings + word * 64;
+        uint64_t mask = 0;
+        for (size_t group = 0; group < 16; ++group) {
+            const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + group * 4));
+            const __m128i out_of_range = _mm_or_si128(_mm_cmplt_epi32(values, min_ratings),
+                                                      _mm_cmpgt_epi32(values, max_ratings));
+            mask |= static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(out_of_range))) << (group * 4);
+        }
+        bits[word] &= ~mask;
+    }
+#endif
+    for (; word * 64 < count; ++word) {
+        const size_t block_size = count - word * 64 < 64 ? count - word * 64 : 64;
+        bits[word] &= ~GetOutOfRangeMaskScalar(ratings + word * 64, block_size, min_rating, max_rating);
+    }
+}
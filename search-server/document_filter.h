@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "document.h"
+
+inline constexpr size_t DOCUMENT_STATUS_COUNT = 4;
+
+// Фильтр по статусу и диапазону рейтинга [min_rating, max_rating]. Годится
+// везде, где ожидается предикат документа, но SearchServer узнаёт его тип
+// при компиляции и проверяет документы по битовым картам и столбцам, не
+// вызывая предикат на каждое вхождение
+struct DocumentFilter {
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    int min_rating = std::numeric_limits<int>::min();
+    int max_rating = std::numeric_limits<int>::max();
+
+    bool HasRatingRange() const {
+        return min_rating != std::numeric_limits<int>::min() || max_rating != std::numeric_limits<int>::max();
+    }
+
+    bool operator()(int /*document_id*/, DocumentStatus document_status, int rating) const {
+        return document_status == status && rating >= min_rating && rating <= max_rating;
+    }
+};
+
+// Сбрасывает в bits биты рейтингов вне [min_rating, max_rating]: бит i
+// отвечает за ratings[i]. Рейтинги сравниваются по 4 за раз (SSE2)
+void FilterRatingRange(const int* ratings, size_t count, int min_rating, int max_rating, uint64_t* bits);
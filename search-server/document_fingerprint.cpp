@@ -0,0 +1,69 @@
+#include "document_fingerprint.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+namespace {
+
+constexpr uint64_t MixBits(uint64_t value) {
+    value += 0x9e3779b97f4a7c15;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+    return value ^ (value >> 31);
+}
+
+// Хеш-функции подписи - (a * h + b) >> 32 с нечётными a от одного
+// 64-битного хеша терма: на терм приходится одно перемешивание и
+// MINHASH_SIZE умножений, которые компилятор векторизует. Коэффициенты
+// считаются при компиляции: ComputeFingerprint может вызываться из
+// конструкторов глобальных объектов других единиц трансляции
+struct MinHashCoefficients {
+    array<uint64_t, DocumentFingerprint::MINHASH_SIZE> multipliers;
+    array<uint64_t, DocumentFingerprint::MINHASH_SIZE> increments;
+
+    constexpr MinHashCoefficients()
+        : multipliers{}
+        , increments{} {
+        for (size_t i = 0; i < DocumentFingerprint::MINHASH_SIZE; ++i) {
+            multipliers[i] = MixBits(2 * i) | 1;
+            increments[i] = MixBits(2 * i + 1);
+        }
+    }
+};
+
+constexpr MinHashCoefficients MIN_HASH_COEFFICIENTS;
+
+} // namespace
+
+DocumentFingerprint ComputeFingerprint(const vector<TermId>& sorted_terms) {
+    DocumentFingerprint fingerprint;
+    fingerprint.term_count = static_cast<uint32_t>(sorted_terms.size());
+    fingerprint.minhash.fill(numeric_limits<uint32_t>::max());
+    uint64_t term_set_hash = sorted_terms.size();
+    for (const TermId term : sorted_terms) {
+        const uint64_t term_hash = MixBits(term);
+        term_set_hash = MixBits(term_set_hash ^ term_hash);
+        for (size_t i = 0; i < DocumentFingerprint::MINHASH_SIZE; ++i) {
+            const auto value = static_cast<uint32_t>(
+                (MIN_HASH_COEFFICIENTS.multipliers[i] * term_hash + MIN_HASH_COEFFICIENTS.increments[i]) >> 32);
+            fingerprint.minhash[i] = min(fingerprint.minhash[i], value);
+        }
+    }
+    fingerprint.term_set_hash = term_set_hash;
+    return fingerprint;
+}
+
+bool HasSameTermSet(const DocumentFingerprint& lhs, const DocumentFingerprint& rhs) {
+    // подпись сверяется, чтобы коллизия 64-битного хеша не склеила разные наборы
+    return lhs.term_set_hash == rhs.term_set_hash && lhs.term_count == rhs.term_count && lhs.minhash == rhs.minhash;
+}
+
+double EstimateSimilarity(const DocumentFingerprint& lhs, const DocumentFingerprint& rhs) {
+    size_t equal_count = 0;
+    for (size_t i = 0; i < DocumentFingerprint::MINHASH_SIZE; ++i) {
+        equal_count += lhs.minhash[i] == rhs.minhash[i];
+    }
+    return static_cast<double>(equal_count) / DocumentFingerprint::MINHASH_SIZE;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "term_dictionary.h"
+
+// Отпечаток набора различных термов документа. term_set_hash совпадает у
+// документов с одинаковым набором слов. MinHash-подпись позволяет оценить
+// сходство наборов (коэффициент Жаккара) без обращения к самим термам:
+// доля совпавших позиций подписи - несмещённая оценка сходства
+struct DocumentFingerprint {
+    static constexpr size_t MINHASH_SIZE = 32;
+
+    uint64_t term_set_hash = 0;
+    uint32_t term_count = 0;
+    std::array<uint32_t, MINHASH_SIZE> minhash{};
+};
+
+// Термы должны быть отсортированы и различны
+DocumentFingerprint ComputeFingerprint(const std::vector<TermId>& sorted_terms);
+bool HasSameTermSet(const DocumentFingerprint& lhs, const DocumentFingerprint& rhs);
+double EstimateSimilarity(const DocumentFingerprint& lhs, const DocumentFingerprint& rhs);
@@ -0,0 +1,11 @@
+#include "index_snapshot.h"
+
+uint64_t ComputeSnapshotChecksum(const void* data, size_t size, uint64_t seed) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Формат файла снимка индекса. Все секции выровнены по 8 байт и читаются
+// прямо из отображённой в память копии файла, без разбора в контейнеры.
+//
+//   SnapshotHeader
+//   SnapshotDocument[document_count]  - по возрастанию id
+//   SnapshotTerm[term_count]          - по алфавиту
+//   SnapshotString[stop_word_count]   - по алфавиту
+//   PostingBlockHeader[block_count]
+//   байты списков вхождений
+//   байты строк
+//
+// В списках вхождений вместо id документа хранится его номер в таблице
+// документов: номера растут вместе с id, и по номеру сразу доступны
+// рейтинг, статус и длина документа
+
+constexpr char SNAPSHOT_MAGIC[8] = {'S', 'R', 'C', 'H', 'S', 'N', 'A', 'P'};
+constexpr uint32_t SNAPSHOT_VERSION = 2;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t file_size;
+    // контрольная сумма всего, что идёт после заголовка
+    uint64_t body_checksum;
+    // контрольная сумма заголовка, посчитанная с нулём в этом поле
+    uint64_t header_checksum;
+
+    uint32_t document_count;
+    uint32_t term_count;
+    uint32_t stop_word_count;
+    uint32_t block_count;
+
+    uint64_t documents_offset;
+    uint64_t terms_offset;
+    uint64_t stop_words_offset;
+    uint64_t blocks_offset;
+    uint64_t postings_offset;
+    uint64_t postings_size;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+    // номер последней записи журнала изменений, учтённой в снимке
+    uint64_t log_sequence;
+};
+
+struct SnapshotDocument {
+    int32_t id;
+    int32_t rating;
+    int32_t status;
+    int32_t word_count;
+};
+
+struct SnapshotString {
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct SnapshotTerm {
+    SnapshotString text;
+    uint32_t first_block;
+    uint32_t block_count;
+    uint64_t postings_offset;
+    uint32_t posting_count;
+    uint32_t reserved;
+    double max_freq;
+};
+
+// FNV-1a, 64 бита
+uint64_t ComputeSnapshotChecksum(const void* data, size_t size, uint64_t seed = 14695981039346656037ULL);
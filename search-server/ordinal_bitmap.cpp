@@ -0,0 +1,139 @@
+#include "ordinal_bitmap.h"
+
+#include <algorithm>
+
+using namespace std;
+
+void OrdinalBitmap::Add(uint32_t ordinal) {
+    const size_t container_index = ordinal >> CONTAINER_BITS;
+    const auto low = static_cast<uint16_t>(ordinal);
+    if (containers_.size() <= container_index) {
+        containers_.resize(container_index + 1);
+    }
+    Container& container = containers_[container_index];
+
+    if (!container.words.empty()) {
+        uint64_t& word = container.words[low / 64];
+        const uint64_t bit = uint64_t{1} << (low % 64);
+        if ((word & bit) == 0) {
+            word |= bit;
+            ++container.cardinality;
+            ++size_;
+        }
+        return;
+    }
+
+    auto& values = container.values;
+    if (values.empty() || values.back() < low) {
+        values.push_back(low);
+    } else {
+        const auto it = lower_bound(values.begin(), values.end(), low);
+        if (*it == low) {
+            return;
+        }
+        values.insert(it, low);
+    }
+    ++container.cardinality;
+    ++size_;
+    if (values.size() > ARRAY_MAX_SIZE) {
+        ConvertToBitmap(container);
+    }
+}
+
+bool OrdinalBitmap::Remove(uint32_t ordinal) {
+    const size_t container_index = ordinal >> CONTAINER_BITS;
+    if (container_index >= containers_.size()) {
+        return false;
+    }
+    const auto low = static_cast<uint16_t>(ordinal);
+    Container& container = containers_[container_index];
+
+    if (!container.words.empty()) {
+        uint64_t& word = container.words[low / 64];
+        const uint64_t bit = uint64_t{1} << (low % 64);
+        if ((word & bit) == 0) {
+            return false;
+        }
+        word &= ~bit;
+        --container.cardinality;
+        --size_;
+        // обратно в массив с запасом, чтобы добавления и удаления на
+        // границе не перестраивали блок каждый раз
+        if (container.cardinality <= ARRAY_MAX_SIZE / 2) {
+            ConvertToArray(container);
+        }
+        return true;
+    }
+
+    auto& values = container.values;
+    const auto it = lower_bound(values.begin(), values.end(), low);
+    if (it == values.end() || *it != low) {
+        return false;
+    }
+    values.erase(it);
+    --container.cardinality;
+    --size_;
+    return true;
+}
+
+bool OrdinalBitmap::Contains(uint32_t ordinal) const {
+    const size_t container_index = ordinal >> CONTAINER_BITS;
+    if (container_index >= containers_.size()) {
+        return false;
+    }
+    const auto low = static_cast<uint16_t>(ordinal);
+    const Container& container = containers_[container_index];
+    if (!container.words.empty()) {
+        return (container.words[low / 64] >> (low % 64)) & 1;
+    }
+    return binary_search(container.values.begin(), container.values.end(), low);
+}
+
+void OrdinalBitmap::OrInto(uint64_t* words, size_t word_count) const {
+    for (size_t container_index = 0; container_index < containers_.size(); ++container_index) {
+        const size_t first_word = container_index * BITMAP_WORD_COUNT;
+        if (first_word >= word_count) {
+            break;
+        }
+        const Container& container = containers_[container_index];
+        if (!container.words.empty()) {
+            const size_t count = min(BITMAP_WORD_COUNT, word_count - first_word);
+            for (size_t i = 0; i < count; ++i) {
+                words[first_word + i] |= container.words[i];
+            }
+            continue;
+        }
+        for (const uint16_t low : container.values) {
+            const size_t word_index = first_word + low / 64;
+            if (word_index < word_count) {
+                words[word_index] |= uint64_t{1} << (low % 64);
+            }
+        }
+    }
+}
+
+size_t OrdinalBitmap::GetMemoryUsage() const {
+    size_t result = containers_.capacity() * sizeof(Container);
+    for (const Container& container : containers_) {
+        result += container.values.capacity() * sizeof(uint16_t) + container.words.capacity() * sizeof(uint64_t);
+    }
+    return result;
+}
+
+void OrdinalBitmap::ConvertToBitmap(Container& container) {
+    container.words.assign(BITMAP_WORD_COUNT, 0);
+    for (const uint16_t low : container.values) {
+        container.words[low / 64] |= uint64_t{1} << (low % 64);
+    }
+    vector<uint16_t>().swap(container.values);
+}
+
+void OrdinalBitmap::ConvertToArray(Container& container) {
+    container.values.reserve(container.cardinality);
+    for (size_t i = 0; i < BITMAP_WORD_COUNT; ++i) {
+        for (uint64_t word = container.words[i]; word != 0; word &= word - 1) {
+            container.values.push_back(static_cast<uint16_t>(i * 64 + __builtin_ctzll(word)));
+        }
+    }
+    vector<uint64_t>().swap(container.words);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Сжатое множество порядковых номеров документов в духе Roaring. Номера
+// делятся на блоки по 65536 по старшим 16 битам. Блок, где не больше
+// ARRAY_MAX_SIZE номеров, хранит отсортированный массив младших 16 бит,
+// более плотный - битовую карту на 8 КБ. Так на номер уходит не больше
+// 2 байт, а проверка принадлежности - обращение к блоку и двоичный поиск
+// или проверка бита
+class OrdinalBitmap {
+public:
+    static constexpr size_t ARRAY_MAX_SIZE = 4096;
+
+    // Номера больше последнего дописываются в конец массива без сдвига
+    void Add(uint32_t ordinal);
+    bool Remove(uint32_t ordinal);
+    bool Contains(uint32_t ordinal) const;
+
+    size_t size() const {
+        return size_;
+    }
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    // Устанавливает в плотной карте words биты всех номеров множества:
+    // номер i - бит i % 64 слова i / 64. Номера за пределами карты пропускаются
+    void OrInto(uint64_t* words, size_t word_count) const;
+    size_t GetMemoryUsage() const;
+
+private:
+    static constexpr size_t CONTAINER_BITS = 16;
+    static constexpr size_t BITMAP_WORD_COUNT = (size_t{1} << CONTAINER_BITS) / 64;
+
+    // Пустой words - блок-массив, иначе блок-карта из BITMAP_WORD_COUNT слов
+    struct Container {
+        std::vector<uint16_t> values;
+        std::vector<uint64_t> words;
+        uint32_t cardinality = 0;
+    };
+
+    // индекс - старшие 16 бит номера
+    std::vector<Container> containers_;
+    size_t size_ = 0;
+
+    static void ConvertToBitmap(Container& container);
+    static void ConvertToArray(Container& container);
+};
@@ -0,0 +1,310 @@
+#include "posting_list.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+template <typename Bytes>
+void WriteVarint(Bytes& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint32_t ReadVarint(const uint8_t*& pos) {
+    uint32_t value = 0;
+    int shift = 0;
+    while (*pos & 0x80) {
+        value |= static_cast<uint32_t>(*pos++ & 0x7F) << shift;
+        shift += 7;
+    }
+    value |= static_cast<uint32_t>(*pos++) << shift;
+    return value;
+}
+
+// Как ReadVarint, но не заходит за end и не принимает числа длиннее 5 байт
+uint32_t ReadVarintChecked(const uint8_t*& pos, const uint8_t* end) {
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (pos == end) {
+            break;
+        }
+        const uint8_t byte = *pos++;
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw runtime_error("Posting block is corrupted"s);
+}
+
+} // namespace
+
+size_t FindPostingBlock(const PostingBlockHeader* blocks, size_t block_count, int document_id) {
+    const auto it = lower_bound(blocks, blocks + block_count, document_id,
+        [](const PostingBlockHeader& block, int id) {
+            return block.last_document_id < id;
+        });
+    return it - blocks;
+}
+
+//          PostingListView
+
+PostingListView::Iterator::Iterator(const PostingBlockHeader* blocks, size_t block_count, const uint8_t* data,
+                                    size_t block_index, PostingBounds bounds)
+    : blocks_(blocks)
+    , block_count_(block_count)
+    , data_(data)
+    , bounds_(bounds) {
+    EnterBlock(block_index);
+}
+
+PostingListView::Iterator& PostingListView::Iterator::operator++() {
+    if (left_in_block_ == 0) {
+        EnterBlock(block_index_ + 1);
+    } else {
+        DecodeNext();
+    }
+    return *this;
+}
+
+void PostingListView::Iterator::SkipTo(int document_id) {
+    if (block_index_ == block_count_ || current_.document_id >= document_id) {
+        return;
+    }
+    if (blocks_[block_index_].last_document_id < document_id) {
+        const size_t next = block_index_ + 1;
+        EnterBlock(next + FindPostingBlock(blocks_ + next, block_count_ - next, document_id));
+    }
+    while (block_index_ != block_count_ && current_.document_id < document_id) {
+        ++*this;
+    }
+}
+
+void PostingListView::Iterator::EnterBlock(size_t block_index) {
+    block_index_ = block_index;
+    if (block_index_ >= block_count_) {
+        block_index_ = block_count_;
+        left_in_block_ = 0;
+        return;
+    }
+    const PostingBlockHeader& block = blocks_[block_index_];
+    if (bounds_.data_end != nullptr) {
+        CheckBlock(block);
+    }
+    pos_ = data_ + block.offset;
+    left_in_block_ = block.size;
+    current_.document_id = block.first_document_id;
+    DecodeNext();
+}
+
+void PostingListView::Iterator::DecodeNext() {
+    if (bounds_.data_end != nullptr) {
+        DecodeNextChecked();
+        return;
+    }
+    current_.document_id += static_cast<int>(ReadVarint(pos_));
+    current_.count = ReadVarint(pos_);
+    --left_in_block_;
+}
+
+void PostingListView::Iterator::CheckBlock(const PostingBlockHeader& block) {
+    // байты блока кончаются там, где начинается следующий блок списка
+    const size_t data_size = bounds_.data_end - data_;
+    const size_t end_offset = block_index_ + 1 < block_count_ ? blocks_[block_index_ + 1].offset : data_size;
+    if (block.size == 0 || block.offset > end_offset || end_offset > data_size || block.first_document_id < 0
+        || block.first_document_id > block.last_document_id || block.last_document_id >= bounds_.document_limit) {
+        throw runtime_error("Posting block is corrupted"s);
+    }
+    block_end_ = data_ + end_offset;
+}
+
+void PostingListView::Iterator::DecodeNextChecked() {
+    const int64_t document_id = int64_t{current_.document_id} + ReadVarintChecked(pos_, block_end_);
+    if (document_id > blocks_[block_index_].last_document_id) {
+        throw runtime_error("Posting block is corrupted"s);
+    }
+    current_.document_id = static_cast<int>(document_id);
+    current_.count = ReadVarintChecked(pos_, block_end_);
+    --left_in_block_;
+}
+
+size_t PostingListView::size() const {
+    size_t result = 0;
+    for (size_t i = 0; i < block_count_; ++i) {
+        result += blocks_[i].size;
+    }
+    return result;
+}
+
+uint32_t PostingListView::GetCount(int document_id) const {
+    const size_t block_index = FindPostingBlock(blocks_, block_count_, document_id);
+    if (block_index == block_count_ || blocks_[block_index].first_document_id > document_id) {
+        return 0;
+    }
+    Iterator it(blocks_, block_count_, data_, block_index, bounds_);
+    it.SkipTo(document_id);
+    return it->document_id == document_id ? it->count : 0;
+}
+
+//          PostingList
+
+PostingList::PostingList(const allocator_type& allocator)
+    : blocks_(allocator)
+    , data_(allocator) {
+}
+
+PostingList::PostingList(const PostingList& other, const allocator_type& allocator)
+    : blocks_(other.blocks_, allocator)
+    , data_(other.data_, allocator)
+    , posting_count_(other.posting_count_) {
+}
+
+PostingList::PostingList(PostingList&& other, const allocator_type& allocator)
+    : blocks_(move(other.blocks_), allocator)
+    , data_(move(other.data_), allocator)
+    , posting_count_(other.posting_count_) {
+}
+
+void PostingList::Add(int document_id, uint32_t count) {
+    if (blocks_.empty() || blocks_.back().last_document_id < document_id) {
+        if (blocks_.empty() || blocks_.back().size == BLOCK_SIZE) {
+            blocks_.push_back({document_id, document_id, static_cast<uint32_t>(data_.size()), 0});
+        }
+        PostingBlockHeader& block = blocks_.back();
+        WriteVarint(data_, static_cast<uint32_t>(document_id - block.last_document_id));
+        WriteVarint(data_, count);
+        block.last_document_id = document_id;
+        ++block.size;
+        ++posting_count_;
+        return;
+    }
+
+    const size_t block_index = FindPostingBlock(blocks_.data(), blocks_.size(), document_id);
+    auto postings = DecodeBlock(block_index);
+    const auto it = lower_bound(postings.begin(), postings.end(), document_id,
+        [](const Posting& posting, int id) {
+            return posting.document_id < id;
+        });
+    if (it != postings.end() && it->document_id == document_id) {
+        it->count += count;
+    } else {
+        postings.insert(it, {document_id, count});
+        ++posting_count_;
+    }
+    ReplaceBlock(block_index, postings);
+}
+
+bool PostingList::Remove(int document_id) {
+    const size_t block_index = FindPostingBlock(blocks_.data(), blocks_.size(), document_id);
+    if (block_index == blocks_.size() || blocks_[block_index].first_document_id > document_id) {
+        return false;
+    }
+    auto postings = DecodeBlock(block_index);
+    const auto it = find_if(postings.begin(), postings.end(),
+        [document_id](const Posting& posting) {
+            return posting.document_id == document_id;
+        });
+    if (it == postings.end()) {
+        return false;
+    }
+    postings.erase(it);
+    --posting_count_;
+    ReplaceBlock(block_index, postings);
+    return true;
+}
+
+size_t PostingList::GetMemoryUsage() const {
+    return sizeof(*this)
+        + blocks_.capacity() * sizeof(PostingBlockHeader)
+        + data_.capacity() * sizeof(uint8_t);
+}
+
+vector<Posting> PostingList::DecodeBlock(size_t block_index) const {
+    vector<Posting> result;
+    result.reserve(blocks_[block_index].size + 1);
+    PostingListView::Iterator it(blocks_.data(), blocks_.size(), data_.data(), block_index);
+    for (uint32_t i = 0; i < blocks_[block_index].size; ++i, ++it) {
+        result.push_back(*it);
+    }
+    return result;
+}
+
+void PostingList::ReplaceBlock(size_t block_index, const vector<Posting>& postings) {
+    vector<PostingBlockHeader> new_blocks;
+    vector<uint8_t> new_data;
+    const uint32_t begin_offset = blocks_[block_index].offset;
+    for (size_t first = 0; first < postings.size(); first += BLOCK_SIZE) {
+        const size_t last = min(first + BLOCK_SIZE, postings.size());
+        PostingBlockHeader block{postings[first].document_id, postings[last - 1].document_id,
+                                 static_cast<uint32_t>(begin_offset + new_data.size()),
+                                 static_cast<uint32_t>(last - first)};
+        int previous_id = block.first_document_id;
+        for (size_t i = first; i < last; ++i) {
+            WriteVarint(new_data, static_cast<uint32_t>(postings[i].document_id - previous_id));
+            WriteVarint(new_data, postings[i].count);
+            previous_id = postings[i].document_id;
+        }
+        new_blocks.push_back(block);
+    }
+
+    const uint32_t end_offset = block_index + 1 < blocks_.size()
+                                ? blocks_[block_index + 1].offset
+                                : static_cast<uint32_t>(data_.size());
+    const auto shift = static_cast<int64_t>(new_data.size()) - (end_offset - begin_offset);
+    for (size_t i = block_index + 1; i < blocks_.size(); ++i) {
+        blocks_[i].offset = static_cast<uint32_t>(blocks_[i].offset + shift);
+    }
+
+    data_.erase(data_.begin() + begin_offset, data_.begin() + end_offset);
+    data_.insert(data_.begin() + begin_offset, new_data.begin(), new_data.end());
+    blocks_.erase(blocks_.begin() + block_index);
+    blocks_.insert(blocks_.begin() + block_index, new_blocks.begin(), new_blocks.end());
+}
+
+//          PostingStore
+
+PostingStore::PostingStore()
+    : storage_(make_unique<Storage>()) {
+}
+
+PostingStore::PostingStore(const PostingStore& other)
+    : PostingStore() {
+    storage_->lists.reserve(other.size());
+    for (const PostingList& list : other) {
+        storage_->lists.emplace_back(list);
+    }
+}
+
+PostingStore& PostingStore::operator=(const PostingStore& other) {
+    if (this != &other) {
+        *this = PostingStore(other);
+    }
+    return *this;
+}
+
+PostingStore::Storage::Storage()
+    : pool(pmr::pool_options{0, MAX_POOLED_BLOCK}, &arena)
+    , lists(this) {
+}
+
+void* PostingStore::Storage::do_allocate(size_t bytes, size_t alignment) {
+    if (bytes > MAX_POOLED_BLOCK) {
+        return pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    return pool.allocate(bytes, alignment);
+}
+
+void PostingStore::Storage::do_deallocate(void* pointer, size_t bytes, size_t alignment) {
+    if (bytes > MAX_POOLED_BLOCK) {
+        pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+    } else {
+        pool.deallocate(pointer, bytes, alignment);
+    }
+}
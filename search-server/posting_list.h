@@ -0,0 +1,245 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+#include "arena.h"
+
+// Заголовок блока - данные для пропуска: по нему можно найти нужный блок
+// двоичным поиском, не распаковывая остальные
+struct PostingBlockHeader {
+    int32_t first_document_id;
+    int32_t last_document_id;
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct Posting {
+    int document_id;
+    uint32_t count;
+};
+
+// Границы недоверенного списка: байты блоков лежат в [data, data_end), а id
+// документов меньше document_limit
+struct PostingBounds {
+    const uint8_t* data_end = nullptr;
+    int document_limit = 0;
+};
+
+// Неизменяемое представление списка вхождений. Не владеет памятью, поэтому
+// может указывать как на PostingList, так и на отображённый в память файл.
+// Для списков из файла задаются границы: тогда каждый блок при распаковке
+// проверяется по ним, и испорченный блок бросает runtime_error вместо чтения
+// за пределами данных
+class PostingListView {
+public:
+    PostingListView() = default;
+    PostingListView(const PostingBlockHeader* blocks, size_t block_count, const uint8_t* data)
+        : blocks_(blocks)
+        , block_count_(block_count)
+        , data_(data) {
+    }
+    PostingListView(const PostingBlockHeader* blocks, size_t block_count, const uint8_t* data, PostingBounds bounds)
+        : blocks_(blocks)
+        , block_count_(block_count)
+        , data_(data)
+        , bounds_(bounds) {
+    }
+
+    class Iterator {
+    public:
+        Iterator() = default;
+        Iterator(const PostingBlockHeader* blocks, size_t block_count, const uint8_t* data, size_t block_index,
+                 PostingBounds bounds = {});
+
+        const Posting& operator*() const {
+            return current_;
+        }
+        const Posting* operator->() const {
+            return &current_;
+        }
+        Iterator& operator++();
+        bool operator==(const Iterator& other) const {
+            return block_index_ == other.block_index_ && left_in_block_ == other.left_in_block_;
+        }
+        bool operator!=(const Iterator& other) const {
+            return !(*this == other);
+        }
+
+        // Переходит к первому документу с id >= document_id
+        void SkipTo(int document_id);
+
+    private:
+        const PostingBlockHeader* blocks_ = nullptr;
+        size_t block_count_ = 0;
+        const uint8_t* data_ = nullptr;
+        size_t block_index_ = 0;
+        const uint8_t* pos_ = nullptr;
+        uint32_t left_in_block_ = 0;
+        Posting current_{};
+        PostingBounds bounds_;
+        // конец байтов текущего блока, только для списков с границами
+        const uint8_t* block_end_ = nullptr;
+
+        void EnterBlock(size_t block_index);
+        void DecodeNext();
+        void CheckBlock(const PostingBlockHeader& block);
+        void DecodeNextChecked();
+    };
+
+    Iterator begin() const {
+        return Iterator(blocks_, block_count_, data_, 0, bounds_);
+    }
+    Iterator end() const {
+        return Iterator(blocks_, block_count_, data_, block_count_, bounds_);
+    }
+
+    size_t size() const;
+    bool empty() const {
+        return block_count_ == 0;
+    }
+
+    // Число вхождений терма в документ, 0 - если документа в списке нет
+    uint32_t GetCount(int document_id) const;
+    bool Contains(int document_id) const {
+        return GetCount(document_id) > 0;
+    }
+
+private:
+    const PostingBlockHeader* blocks_ = nullptr;
+    size_t block_count_ = 0;
+    const uint8_t* data_ = nullptr;
+    PostingBounds bounds_;
+};
+
+// Список вхождений терма: id документов по возрастанию, разбитые на блоки
+// по BLOCK_SIZE. Внутри блока id хранятся как varint-разности с предыдущим,
+// рядом - varint числа вхождений терма в документ
+class PostingList {
+public:
+    static constexpr size_t BLOCK_SIZE = 128;
+
+    // Память блоков берётся у распределителя: так списки PostingStore
+    // живут в его пуле
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+    PostingList() = default;
+    explicit PostingList(const allocator_type& allocator);
+    PostingList(const PostingList& other, const allocator_type& allocator);
+    PostingList(PostingList&& other, const allocator_type& allocator);
+    PostingList(const PostingList&) = default;
+    PostingList(PostingList&&) = default;
+    PostingList& operator=(const PostingList&) = default;
+    PostingList& operator=(PostingList&&) = default;
+
+    // Добавляет count вхождений документа; документы с id больше последнего
+    // дописываются в конец без перекодирования
+    void Add(int document_id, uint32_t count);
+    bool Remove(int document_id);
+
+    PostingListView GetView() const {
+        return PostingListView(blocks_.data(), blocks_.size(), data_.data());
+    }
+
+    size_t size() const {
+        return posting_count_;
+    }
+    bool empty() const {
+        return posting_count_ == 0;
+    }
+    size_t GetMemoryUsage() const;
+
+    const std::pmr::vector<PostingBlockHeader>& GetBlocks() const {
+        return blocks_;
+    }
+    const std::pmr::vector<uint8_t>& GetData() const {
+        return data_;
+    }
+
+private:
+    std::pmr::vector<PostingBlockHeader> blocks_;
+    std::pmr::vector<uint8_t> data_;
+    size_t posting_count_ = 0;
+
+    std::vector<Posting> DecodeBlock(size_t block_index) const;
+    void ReplaceBlock(size_t block_index, const std::vector<Posting>& postings);
+};
+
+// Индекс первого блока, в котором может находиться document_id
+size_t FindPostingBlock(const PostingBlockHeader* blocks, size_t block_count, int document_id);
+
+// Списки вхождений всех термов индекса, позиция - TermId. Небольшие блоки
+// списков раздаёт пул поверх арены: они лежат плотно, без заголовков кучи,
+// освобождённые переиспользуются пулом, а вся память возвращается разом
+// вместе с хранилищем. Большие блоки идут в кучу напрямую, иначе
+// перевыделения растущих списков копились бы в арене. Разные списки можно
+// менять из разных потоков, сам массив списков - нет
+class PostingStore {
+public:
+    PostingStore();
+    // Копия раскладывает списки в своём пуле
+    PostingStore(const PostingStore& other);
+    PostingStore(PostingStore&&) = default;
+    PostingStore& operator=(const PostingStore& other);
+    PostingStore& operator=(PostingStore&&) = default;
+
+    PostingList& operator[](size_t term) {
+        return storage_->lists[term];
+    }
+    const PostingList& operator[](size_t term) const {
+        return storage_->lists[term];
+    }
+
+    size_t size() const {
+        return storage_->lists.size();
+    }
+    size_t capacity() const {
+        return storage_->lists.capacity();
+    }
+    void resize(size_t size) {
+        storage_->lists.resize(size);
+    }
+    PostingList& emplace_back() {
+        return storage_->lists.emplace_back();
+    }
+
+    std::pmr::vector<PostingList>::const_iterator begin() const {
+        return storage_->lists.begin();
+    }
+    std::pmr::vector<PostingList>::const_iterator end() const {
+        return storage_->lists.end();
+    }
+
+    // Память арены, взятая у кучи, в байтах
+    size_t GetArenaCapacity() const {
+        return storage_->arena.GetCapacity();
+    }
+
+private:
+    // блоки больше этого размера пул не обслуживает
+    static constexpr size_t MAX_POOLED_BLOCK = 64 * 1024;
+
+    // Хранилище не перемещается вместе с PostingStore: память списков
+    // ссылается на его пул
+    class Storage : public std::pmr::memory_resource {
+    public:
+        Storage();
+
+        Arena arena;
+        std::pmr::synchronized_pool_resource pool;
+        // объявлен последним, чтобы вернуть блоки в пул до его разрушения
+        std::pmr::vector<PostingList> lists;
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    };
+
+    std::unique_ptr<Storage> storage_;
+};
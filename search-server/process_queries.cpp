@@ -1,5 +1,12 @@
 #include  "process_queries.h"
 
+JoinedDocuments::JoinedDocuments(std::vector<std::vector<Document>> documents)
+    : documents_(std::move(documents)) {
+    for (const auto& query_documents : documents_) {
+        size_ += query_documents.size();
+    }
+}
+
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
     const std::vector<std::string>& queries) {
@@ -8,7 +15,7 @@ std::vector<std::vector<Document>> ProcessQueries(
     std::transform(std::execution::par,
  queries.begin(), queries.end(),
  result.begin(),
- [&search_server](const std::string buff) {
+ [&search_server](const std::string& buff) {
             return search_server.FindTopDocuments(buff);
         });
     return result;
@@ -25,4 +32,31 @@ std::list<Document> ProcessQueriesJoined(
         }
     }
     return result;
-}
\ No newline at end of file
+}
+
+std::vector<std::vector<Document>> ProcessQueriesShared(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries) {
+
+    return search_server.FindTopDocumentsBatch(std::execution::par, queries);
+}
+
+std::vector<std::vector<Document>> ProcessQueries(
+    ThreadPool& thread_pool,
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries) {
+
+    std::vector<std::vector<Document>> result(queries.size());
+    thread_pool.ParallelFor(queries.size(), [&](size_t i) {
+        result[i] = search_server.FindTopDocuments(queries[i]);
+    });
+    return result;
+}
+
+JoinedDocuments ProcessQueriesJoined(
+    ThreadPool& thread_pool,
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries) {
+
+    return JoinedDocuments(ProcessQueries(thread_pool, search_server, queries));
+}
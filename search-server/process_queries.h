@@ -1,17 +1,123 @@
 #pragma once
 #include "document.h"
 #include"search_server.h"
+#include "thread_pool.h"
 
 #include <vector>
 #include <execution>
 #include <algorithm>
+#include <iterator>
 #include <string>
 #include <list>
 
+// Результаты пакета запросов одной последовательностью. Хранит результаты
+// по запросам как есть и обходит их подряд, ничего не копируя. Ленив только
+// обход: объект строится, когда выполнены все запросы пакета, и первые
+// результаты не выдаются раньше последних
+class JoinedDocuments {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Document;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Document*;
+        using reference = const Document&;
+
+        Iterator() = default;
+        Iterator(const std::vector<Document>* query, const std::vector<Document>* query_end)
+            : query_(query)
+            , query_end_(query_end) {
+            SkipEmpty();
+        }
+
+        reference operator*() const {
+            return (*query_)[index_];
+        }
+        pointer operator->() const {
+            return &(*query_)[index_];
+        }
+        Iterator& operator++() {
+            ++index_;
+            SkipEmpty();
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator result = *this;
+            ++*this;
+            return result;
+        }
+        bool operator==(const Iterator& other) const {
+            return query_ == other.query_ && index_ == other.index_;
+        }
+        bool operator!=(const Iterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        const std::vector<Document>* query_ = nullptr;
+        const std::vector<Document>* query_end_ = nullptr;
+        size_t index_ = 0;
+
+        void SkipEmpty() {
+            while (query_ != query_end_ && index_ == query_->size()) {
+                ++query_;
+                index_ = 0;
+            }
+        }
+    };
+
+    JoinedDocuments() = default;
+    explicit JoinedDocuments(std::vector<std::vector<Document>> documents);
+
+    Iterator begin() const {
+        return Iterator(documents_.data(), documents_.data() + documents_.size());
+    }
+    Iterator end() const {
+        const std::vector<Document>* query_end = documents_.data() + documents_.size();
+        return Iterator(query_end, query_end);
+    }
+
+    size_t size() const {
+        return size_;
+    }
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    // Результаты по запросам в порядке запросов
+    const std::vector<std::vector<Document>>& GetQueryResults() const {
+        return documents_;
+    }
+
+private:
+    std::vector<std::vector<Document>> documents_;
+    size_t size_ = 0;
+};
+
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
     const std::vector<std::string>& queries);
 
 std::list<Document> ProcessQueriesJoined(
     const SearchServer& search_server,
-    const std::vector<std::string>& queries);
\ No newline at end of file
+    const std::vector<std::string>& queries);
+
+// То же с общим обходом списков вхождений (SearchServer::FindTopDocumentsBatch):
+// выгоднее, когда запросы пакета часто делят одни и те же слова
+std::vector<std::vector<Document>> ProcessQueriesShared(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries);
+
+// То же на потоках пула: запросы раздаются рабочим потокам частями, а
+// освободившиеся потоки забирают необработанные части у занятых
+std::vector<std::vector<Document>> ProcessQueries(
+    ThreadPool& thread_pool,
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries);
+
+// Возвращает управление после выполнения всех запросов
+JoinedDocuments ProcessQueriesJoined(
+    ThreadPool& thread_pool,
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries);
@@ -0,0 +1,74 @@
+#include "query_cache.h"
+
+#include <algorithm>
+
+using namespace std;
+
+QueryCache::QueryCache(size_t max_size, size_t segment_count)
+    : max_segment_size_(max<size_t>(1, (max_size + segment_count - 1) / segment_count))
+    , segments_(segment_count) {
+}
+
+optional<vector<Document>> QueryCache::Find(const QueryCacheKey& key, uint64_t generation) {
+    Segment& segment = GetSegment(key);
+    lock_guard guard(segment.mutex);
+    const auto it = segment.index.find(key);
+    if (it == segment.index.end()) {
+        ++misses_;
+        return nullopt;
+    }
+    if (it->second->generation != generation) {
+        segment.entries.erase(it->second);
+        segment.index.erase(it);
+        ++misses_;
+        return nullopt;
+    }
+    segment.entries.splice(segment.entries.begin(), segment.entries, it->second);
+    ++hits_;
+    return it->second->documents;
+}
+
+void QueryCache::Insert(const QueryCacheKey& key, uint64_t generation, const vector<Document>& documents) {
+    Segment& segment = GetSegment(key);
+    lock_guard guard(segment.mutex);
+    if (const auto it = segment.index.find(key); it != segment.index.end()) {
+        it->second->generation = generation;
+        it->second->documents = documents;
+        segment.entries.splice(segment.entries.begin(), segment.entries, it->second);
+        return;
+    }
+    if (segment.entries.size() == max_segment_size_) {
+        segment.index.erase(segment.entries.back().key);
+        segment.entries.pop_back();
+    }
+    segment.entries.push_front({key, generation, documents});
+    segment.index.emplace(key, segment.entries.begin());
+}
+
+QueryCacheStats QueryCache::GetStats() const {
+    QueryCacheStats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    for (const Segment& segment : segments_) {
+        lock_guard guard(segment.mutex);
+        stats.size += segment.entries.size();
+    }
+    return stats;
+}
+
+size_t QueryCache::KeyHasher::operator()(const QueryCacheKey& key) const {
+    size_t hash = static_cast<size_t>(key.status) * 31 + key.max_document_count;
+    for (const TermId term : key.plus_terms) {
+        hash = hash * 1'000'003 + term;
+    }
+    // разделитель, чтобы слово не переходило из плюс-слов в минус-слова
+    hash = hash * 1'000'003 + 0x9E3779B9;
+    for (const TermId term : key.minus_terms) {
+        hash = hash * 1'000'003 + term;
+    }
+    return hash;
+}
+
+QueryCache::Segment& QueryCache::GetSegment(const QueryCacheKey& key) {
+    return segments_[KeyHasher{}(key) % segments_.size()];
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "document.h"
+#include "term_dictionary.h"
+
+// Канонический запрос: отсортированные списки различных плюс- и минус-слов
+// вместе со статусом и размером выдачи. Запросы, отличающиеся порядком слов,
+// повторами или стоп-словами, дают один ключ
+struct QueryCacheKey {
+    std::vector<TermId> plus_terms;
+    std::vector<TermId> minus_terms;
+    DocumentStatus status;
+    size_t max_document_count;
+
+    bool operator==(const QueryCacheKey& other) const {
+        return status == other.status && max_document_count == other.max_document_count
+            && plus_terms == other.plus_terms && minus_terms == other.minus_terms;
+    }
+};
+
+struct QueryCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    size_t size = 0;
+};
+
+// Кеш результатов поиска с вытеснением давно не использованных записей.
+// Записи разложены по сегментам со своими мьютексами, чтобы параллельные
+// запросы редко ждали друг друга. Каждая запись помечена поколением индекса:
+// после изменения индекса старые записи считаются промахом и удаляются
+class QueryCache {
+public:
+    explicit QueryCache(size_t max_size, size_t segment_count = 16);
+
+    std::optional<std::vector<Document>> Find(const QueryCacheKey& key, uint64_t generation);
+    void Insert(const QueryCacheKey& key, uint64_t generation, const std::vector<Document>& documents);
+
+    QueryCacheStats GetStats() const;
+    // Вместимость с учётом округления до целых сегментов
+    size_t GetMaxSize() const {
+        return max_segment_size_ * segments_.size();
+    }
+
+private:
+    struct KeyHasher {
+        size_t operator()(const QueryCacheKey& key) const;
+    };
+    struct Entry {
+        QueryCacheKey key;
+        uint64_t generation;
+        std::vector<Document> documents;
+    };
+    struct Segment {
+        mutable std::mutex mutex;
+        // в начале - недавно использованные записи
+        std::list<Entry> entries;
+        std::unordered_map<QueryCacheKey, std::list<Entry>::iterator, KeyHasher> index;
+    };
+
+    size_t max_segment_size_;
+    std::vector<Segment> segments_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+
+    Segment& GetSegment(const QueryCacheKey& key);
+};
@@ -0,0 +1,134 @@
+#include "remove_duplicates.h"
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <unordered_map>
+
+#include "document_fingerprint.h"
+
+using namespace std;
+
+namespace {
+
+// Подпись делится на полосы по BAND_ROWS значений; документы становятся
+// кандидатами, если хотя бы одна полоса совпала целиком. Вероятность этого
+// для сходства s равна 1 - (1 - s^4)^8: около 0.98 при s = 0.8 и 0.05 при s = 0.3
+constexpr size_t BAND_ROWS = 4;
+constexpr size_t BAND_COUNT = DocumentFingerprint::MINHASH_SIZE / BAND_ROWS;
+
+class DisjointSets {
+public:
+    explicit DisjointSets(size_t size)
+        : parents_(size) {
+        iota(parents_.begin(), parents_.end(), 0);
+    }
+
+    size_t Find(size_t index) {
+        while (parents_[index] != index) {
+            parents_[index] = parents_[parents_[index]];
+            index = parents_[index];
+        }
+        return index;
+    }
+
+    // корнем остаётся меньший индекс, то есть документ с меньшим id
+    void Unite(size_t lhs, size_t rhs) {
+        lhs = Find(lhs);
+        rhs = Find(rhs);
+        if (lhs > rhs) {
+            swap(lhs, rhs);
+        }
+        parents_[rhs] = lhs;
+    }
+
+private:
+    vector<size_t> parents_;
+};
+
+uint64_t HashBand(const DocumentFingerprint& fingerprint, size_t band) {
+    uint64_t hash = band;
+    for (size_t i = band * BAND_ROWS; i < (band + 1) * BAND_ROWS; ++i) {
+        hash = hash * 0x100000001b3 ^ fingerprint.minhash[i];
+    }
+    return hash;
+}
+
+} // namespace
+
+vector<vector<int>> FindDuplicateGroups(const SearchServer& search_server, double min_similarity) {
+    const vector<int> document_ids(search_server.begin(), search_server.end());
+    vector<const DocumentFingerprint*> fingerprints;
+    fingerprints.reserve(document_ids.size());
+    for (const int document_id : document_ids) {
+        fingerprints.push_back(&search_server.GetDocumentFingerprint(document_id));
+    }
+    DisjointSets groups(document_ids.size());
+
+    // точные дубликаты: первый документ с таким набором слов представляет
+    // всю группу и дальше участвует в поиске почти-дубликатов один
+    vector<size_t> representatives;
+    unordered_map<uint64_t, vector<size_t>> term_sets;
+    term_sets.reserve(document_ids.size());
+    for (size_t i = 0; i < document_ids.size(); ++i) {
+        auto& same_hash = term_sets[fingerprints[i]->term_set_hash];
+        const auto it = find_if(same_hash.begin(), same_hash.end(), [&](size_t other) {
+            return HasSameTermSet(*fingerprints[other], *fingerprints[i]);
+        });
+        if (it != same_hash.end()) {
+            groups.Unite(*it, i);
+        } else {
+            same_hash.push_back(i);
+            representatives.push_back(i);
+        }
+    }
+
+    if (min_similarity < 1.0) {
+        // в корзине полосы остаются только попарно непохожие документы:
+        // похожий на кого-то из них документ уходит в его группу, поэтому
+        // корзины с множеством копий не разрастаются
+        for (size_t band = 0; band < BAND_COUNT; ++band) {
+            unordered_map<uint64_t, vector<size_t>> buckets;
+            buckets.reserve(representatives.size());
+            for (const size_t i : representatives) {
+                auto& bucket = buckets[HashBand(*fingerprints[i], band)];
+                const auto it = find_if(bucket.begin(), bucket.end(), [&](size_t other) {
+                    return EstimateSimilarity(*fingerprints[other], *fingerprints[i]) >= min_similarity;
+                });
+                if (it != bucket.end()) {
+                    groups.Unite(*it, i);
+                } else {
+                    bucket.push_back(i);
+                }
+            }
+        }
+    }
+
+    vector<vector<int>> result;
+    vector<size_t> group_indexes(document_ids.size(), document_ids.size());
+    for (size_t i = 0; i < document_ids.size(); ++i) {
+        const size_t root = groups.Find(i);
+        if (root == i) {
+            continue;
+        }
+        if (group_indexes[root] == document_ids.size()) {
+            group_indexes[root] = result.size();
+            result.push_back({document_ids[root]});
+        }
+        result[group_indexes[root]].push_back(document_ids[i]);
+    }
+    sort(result.begin(), result.end());
+    return result;
+}
+
+void RemoveDuplicates(SearchServer& search_server, double min_similarity) {
+    vector<int> duplicate_ids;
+    for (const auto& group : FindDuplicateGroups(search_server, min_similarity)) {
+        duplicate_ids.insert(duplicate_ids.end(), group.begin() + 1, group.end());
+    }
+    sort(duplicate_ids.begin(), duplicate_ids.end());
+    for (const int document_id : duplicate_ids) {
+        cout << "Found duplicate document id "s << document_id << endl;
+        search_server.RemoveDocument(document_id);
+    }
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <vector>
+
+#include "search_server.h"
+
+// Группы документов-дубликатов, в каждой группе id по возрастанию, группы -
+// по возрастанию первого id. При min_similarity = 1 дубликаты - документы с
+// одинаковым набором слов. При меньшем пороге добавляются почти-дубликаты:
+// кандидаты находятся через LSH по MinHash-подписям, а пара принимается,
+// если оценка сходства наборов слов не ниже порога. Группы замыкаются по
+// транзитивности. Время почти линейно по числу документов
+std::vector<std::vector<int>> FindDuplicateGroups(const SearchServer& search_server, double min_similarity = 1.0);
+
+// Оставляет в каждой группе дубликатов документ с наименьшим id, остальные
+// удаляет через RemoveDocument, сообщая о каждом
+void RemoveDuplicates(SearchServer& search_server, double min_similarity = 1.0);
@@ -1,41 +1,126 @@
 #include "request_queue.h"
 
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
 using namespace std;
 
+RequestQueue::RequestQueue(const SearchServer& search_server, Clock::duration window, size_t bucket_count)
+    : search_server_(search_server)
+    , start_(Clock::now())
+    , bucket_width_(bucket_count == 0 ? window : window / static_cast<Clock::rep>(bucket_count))
+    , bucket_count_(bucket_count) {
+    if (bucket_count_ == 0 || bucket_width_ <= Clock::duration::zero()) {
+        throw invalid_argument("Window must contain at least one non-empty bucket"s);
+    }
+    buckets_ = make_unique<Bucket[]>(bucket_count_);
+}
+
 vector<Document> RequestQueue::AddFindRequest(const string& raw_query, DocumentStatus status) {
+    const auto start = Clock::now();
     const auto result = search_server_.FindTopDocuments(raw_query, status);
-    AddRequest(result.size());
+    AddRequest(result.size(), Clock::now() - start);
     return result;
 }
 
 vector<Document> RequestQueue::AddFindRequest(const string& raw_query) {
+    const auto start = Clock::now();
     const auto result = search_server_.FindTopDocuments(raw_query);
-    AddRequest(result.size());
+    AddRequest(result.size(), Clock::now() - start);
     return result;
 }
 
 int RequestQueue::GetNoResultRequests() const {
-    return no_results_requests_;
+    return static_cast<int>(GetStats().no_result_count);
+}
+
+RequestStats RequestQueue::GetStats() const {
+    const auto now = Clock::now();
+    const int64_t current_epoch = GetEpoch(now);
+    RequestStats stats;
+    stats.result_count_distribution.assign(RESULT_COUNT_BUCKET_COUNT, 0);
+    vector<uint64_t> latency_counts(LatencyHistogram::BUCKET_COUNT, 0);
+    for (size_t i = 0; i < bucket_count_; ++i) {
+        const Bucket& bucket = buckets_[i];
+        const int64_t epoch = bucket.epoch.load(memory_order_acquire);
+        if (epoch < 0 || epoch + static_cast<int64_t>(bucket_count_) <= current_epoch) {
+            continue;
+        }
+        stats.request_count += bucket.request_count.load(memory_order_relaxed);
+        stats.no_result_count += bucket.no_result_count.load(memory_order_relaxed);
+        for (size_t j = 0; j < RESULT_COUNT_BUCKET_COUNT; ++j) {
+            stats.result_count_distribution[j] += bucket.result_counts[j].load(memory_order_relaxed);
+        }
+        for (size_t j = 0; j < LatencyHistogram::BUCKET_COUNT; ++j) {
+            latency_counts[j] += bucket.latency_counts[j].load(memory_order_relaxed);
+        }
+    }
+
+    // пока окно не прошло целиком, QPS считается по прошедшему времени
+    const chrono::duration<double> covered = min<Clock::duration>(now - start_, bucket_width_ * static_cast<Clock::rep>(bucket_count_));
+    if (covered.count() > 0) {
+        stats.queries_per_second = stats.request_count / covered.count();
+    }
+    if (stats.request_count > 0) {
+        stats.no_result_rate = static_cast<double>(stats.no_result_count) / stats.request_count;
+    }
+    LatencyHistogramSnapshot latency;
+    latency.bucket_counts = move(latency_counts);
+    for (const uint64_t count : latency.bucket_counts) {
+        latency.count += count;
+    }
+    latency.max = numeric_limits<uint64_t>::max();
+    stats.latency_p50_ns = latency.GetPercentile(50);
+    stats.latency_p90_ns = latency.GetPercentile(90);
+    stats.latency_p99_ns = latency.GetPercentile(99);
+    return stats;
 }
 
-struct QueryResult {
-    uint64_t timestamp;
-    int results;
-};
+int64_t RequestQueue::GetEpoch(Clock::time_point time) const {
+    return (time - start_) / bucket_width_;
+}
 
-void RequestQueue::AddRequest(int results_num) {
-    // новый запрос - новая секунда
-    ++current_time_;
-    // удаляем все результаты поиска, которые устарели
-    while (!requests_.empty() && min_in_day_ <= current_time_ - requests_.front().timestamp) {
-        if (0 == requests_.front().results) {
-            --no_results_requests_;
+RequestQueue::Bucket* RequestQueue::AcquireBucket(int64_t epoch) {
+    Bucket& bucket = buckets_[epoch % bucket_count_];
+    int64_t bucket_epoch = bucket.epoch.load(memory_order_acquire);
+    while (bucket_epoch != epoch) {
+        if (bucket_epoch == RESETTING_EPOCH) {
+            // другой поток обнуляет корзину, это несколько сотен записей
+            this_thread::yield();
+        } else if (bucket_epoch > epoch) {
+            // поток простоял целый круг: корзина уже копит более поздний
+            // период, а запрос слишком старый, чтобы попасть в окно
+            return nullptr;
+        } else if (bucket.epoch.compare_exchange_strong(bucket_epoch, RESETTING_EPOCH, memory_order_acquire)) {
+            bucket.request_count.store(0, memory_order_relaxed);
+            bucket.no_result_count.store(0, memory_order_relaxed);
+            for (auto& count : bucket.result_counts) {
+                count.store(0, memory_order_relaxed);
+            }
+            for (auto& count : bucket.latency_counts) {
+                count.store(0, memory_order_relaxed);
+            }
+            bucket.epoch.store(epoch, memory_order_release);
+            return &bucket;
         }
-        requests_.pop_front();
+        bucket_epoch = bucket.epoch.load(memory_order_acquire);
+    }
+    return &bucket;
+}
+
+void RequestQueue::AddRequest(size_t results_num, Clock::duration latency) {
+    Bucket* const acquired = AcquireBucket(GetEpoch(Clock::now()));
+    if (acquired == nullptr) {
+        return;
     }
-    // сохраняем новый результат поиска
-    requests_.push_back({current_time_, results_num});
-    if (0 == results_num) {
-        ++no_results_requests_;
+    Bucket& bucket = *acquired;
+    bucket.request_count.fetch_add(1, memory_order_relaxed);
+    if (results_num == 0) {
+        bucket.no_result_count.fetch_add(1, memory_order_relaxed);
     }
+    bucket.result_counts[min(results_num, RESULT_COUNT_BUCKET_COUNT - 1)].fetch_add(1, memory_order_relaxed);
+    const auto latency_ns = chrono::duration_cast<chrono::nanoseconds>(latency).count();
+    bucket.latency_counts[LatencyHistogram::GetBucketIndex(latency_ns)].fetch_add(1, memory_order_relaxed);
 }
@@ -1,45 +1,86 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
-#include <deque>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "document.h"
 #include "search_server.h"
+#include "search_metrics.h"
 
+// Статистика запросов за скользящее окно
+struct RequestStats {
+    uint64_t request_count = 0;
+    uint64_t no_result_count = 0;
+    double queries_per_second = 0.0;
+    double no_result_rate = 0.0;
+    // время FindTopDocuments, верхние границы корзин гистограммы
+    uint64_t latency_p50_ns = 0;
+    uint64_t latency_p90_ns = 0;
+    uint64_t latency_p99_ns = 0;
+    // индекс - число найденных документов, последний элемент - столько или больше
+    std::vector<uint64_t> result_count_distribution;
+};
+
+// Счётчик запросов для многопоточного фронтенда. Окно разбито на корзины
+// по времени, корзины образуют кольцо: когда время уходит на круг вперёд,
+// корзина обнуляется и начинает копить заново. Запись запроса - несколько
+// атомарных прибавлений без блокировок
 class RequestQueue {
 public:
-    explicit RequestQueue(const SearchServer& search_server)
-        : search_server_(search_server)
-        , no_results_requests_(0)
-        , current_time_(0) {
-    }
-     template <typename DocumentPredicate>
+    using Clock = std::chrono::steady_clock;
+
+    explicit RequestQueue(const SearchServer& search_server,
+                          Clock::duration window = std::chrono::minutes(min_in_day_),
+                          size_t bucket_count = 144);
+
+    template <typename DocumentPredicate>
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate);
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
     std::vector<Document> AddFindRequest(const std::string& raw_query);
+    // Запросы без результатов за окно
     int GetNoResultRequests() const;
- 
+    RequestStats GetStats() const;
+
 private:
-    struct QueryResult {
-        uint64_t timestamp;
-        int results;
+    static constexpr size_t RESULT_COUNT_BUCKET_COUNT = MAX_RESULT_DOCUMENT_COUNT + 1;
+    // номер периода у ещё не использованной и у обнуляемой корзины
+    static constexpr int64_t NO_EPOCH = -1;
+    static constexpr int64_t RESETTING_EPOCH = -2;
+
+    struct alignas(64) Bucket {
+        // номер периода длиной bucket_width_, за который копит корзина
+        std::atomic<int64_t> epoch{NO_EPOCH};
+        std::atomic<uint64_t> request_count{0};
+        std::atomic<uint64_t> no_result_count{0};
+        std::array<std::atomic<uint64_t>, RESULT_COUNT_BUCKET_COUNT> result_counts{};
+        std::array<std::atomic<uint64_t>, LatencyHistogram::BUCKET_COUNT> latency_counts{};
     };
-    std::deque<QueryResult> requests_;
+
     const SearchServer& search_server_;
-    int no_results_requests_;
-    uint64_t current_time_;
+    const Clock::time_point start_;
+    const Clock::duration bucket_width_;
+    const size_t bucket_count_;
+    std::unique_ptr<Bucket[]> buckets_;
     const static int min_in_day_ = 1440;
- 
-    void AddRequest(int results_num); 
+
+    int64_t GetEpoch(Clock::time_point time) const;
+    // Корзина периода epoch, обнулённая при первом обращении в этом периоде;
+    // nullptr, если период уже вытеснен из кольца
+    Bucket* AcquireBucket(int64_t epoch);
+    void AddRequest(size_t results_num, Clock::duration latency);
 };
 
 
 //          TEMPLATE FUNCTIONS REALIZATION
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
+    const auto start = Clock::now();
     const auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
-    AddRequest(result.size());
+    AddRequest(result.size(), Clock::now() - start);
     return result;
 }
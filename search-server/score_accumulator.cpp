@@ -0,0 +1,58 @@
+#include "score_accumulator.h"
+
+#include "arena.h"
+
+using namespace std;
+
+namespace {
+
+vector<unique_ptr<ScoreAccumulator>>& GetThreadPool() {
+    thread_local vector<unique_ptr<ScoreAccumulator>> pool;
+    return pool;
+}
+
+} // namespace
+
+void ScoreAccumulator::Resize(size_t ordinal_count) {
+    if (scores_.size() < ordinal_count) {
+        scores_.resize(ordinal_count, 0.0);
+        states_.resize(ordinal_count, State::UNTOUCHED);
+    }
+}
+
+void ScoreAccumulator::MergeFrom(const ScoreAccumulator& other) {
+    for (const uint32_t ordinal : other.touched_) {
+        Add(ordinal, other.scores_[ordinal]);
+    }
+}
+
+void ScoreAccumulator::Clear() {
+    for (const uint32_t ordinal : touched_) {
+        scores_[ordinal] = 0.0;
+        states_[ordinal] = State::UNTOUCHED;
+    }
+    touched_.clear();
+}
+
+ScoreAccumulatorLease::ScoreAccumulatorLease(size_t count, size_t ordinal_count)
+    : accumulators_(GetScratchResource()) {
+    auto& pool = GetThreadPool();
+    accumulators_.reserve(count);
+    while (accumulators_.size() < count) {
+        if (pool.empty()) {
+            accumulators_.push_back(make_unique<ScoreAccumulator>());
+        } else {
+            accumulators_.push_back(move(pool.back()));
+            pool.pop_back();
+        }
+        accumulators_.back()->Resize(ordinal_count);
+    }
+}
+
+ScoreAccumulatorLease::~ScoreAccumulatorLease() {
+    auto& pool = GetThreadPool();
+    for (auto& accumulator : accumulators_) {
+        accumulator->Clear();
+        pool.push_back(move(accumulator));
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+// Плотный массив релевантностей, индексированный порядковым номером
+// документа. Список затронутых номеров позволяет обходить и очищать
+// накопитель за O(числа найденных документов), а не O(размера индекса)
+class ScoreAccumulator {
+public:
+    void Resize(size_t ordinal_count);
+
+    void Add(uint32_t ordinal, double score) {
+        if (states_[ordinal] == State::UNTOUCHED) {
+            states_[ordinal] = State::TOUCHED;
+            touched_.push_back(ordinal);
+        }
+        scores_[ordinal] += score;
+    }
+
+    // Исключённый документ не попадёт в ForEach, даже если его счёт
+    // будет увеличен позже
+    void Exclude(uint32_t ordinal) {
+        if (states_[ordinal] == State::TOUCHED) {
+            states_[ordinal] = State::EXCLUDED;
+        }
+    }
+
+    bool IsTouched(uint32_t ordinal) const {
+        return states_[ordinal] != State::UNTOUCHED;
+    }
+
+    void MergeFrom(const ScoreAccumulator& other);
+
+    size_t GetTouchedCount() const {
+        return touched_.size();
+    }
+
+    template <typename Function>
+    void ForEach(Function function) const {
+        for (const uint32_t ordinal : touched_) {
+            if (states_[ordinal] == State::TOUCHED) {
+                function(ordinal, scores_[ordinal]);
+            }
+        }
+    }
+
+    void Clear();
+
+private:
+    enum class State : uint8_t {
+        UNTOUCHED,
+        TOUCHED,
+        EXCLUDED,
+    };
+
+    std::vector<double> scores_;
+    std::vector<State> states_;
+    std::vector<uint32_t> touched_;
+};
+
+// Берёт накопители из пула текущего потока и возвращает их туда при
+// разрушении. Пул свой у каждого потока, поэтому блокировки не нужны, а
+// вложенные запросы на том же потоке получают разные накопители. Список
+// взятых лежит в памяти запроса (GetScratchResource)
+class ScoreAccumulatorLease {
+public:
+    ScoreAccumulatorLease(size_t count, size_t ordinal_count);
+    ~ScoreAccumulatorLease();
+
+    ScoreAccumulatorLease(const ScoreAccumulatorLease&) = delete;
+    ScoreAccumulatorLease& operator=(const ScoreAccumulatorLease&) = delete;
+
+    ScoreAccumulator& operator[](size_t index) {
+        return *accumulators_[index];
+    }
+
+    size_t size() const {
+        return accumulators_.size();
+    }
+
+private:
+    std::pmr::vector<std::unique_ptr<ScoreAccumulator>> accumulators_;
+};
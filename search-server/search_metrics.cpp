@@ -0,0 +1,201 @@
+#include "search_metrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+
+void PrintHistogramText(ostream& out, string_view name, const LatencyHistogramSnapshot& histogram) {
+    out << name << ": count="s << histogram.count
+        << " mean_us="s << histogram.GetMean() / 1000
+        << " p50_us="s << histogram.GetPercentile(50) / 1000.0
+        << " p90_us="s << histogram.GetPercentile(90) / 1000.0
+        << " p99_us="s << histogram.GetPercentile(99) / 1000.0
+        << " max_us="s << histogram.max / 1000.0 << '\n';
+}
+
+void PrintHistogramJson(ostream& out, string_view name, const LatencyHistogramSnapshot& histogram) {
+    out << '"' << name << "\":{\"count\":"s << histogram.count
+        << ",\"mean_ns\":"s << histogram.GetMean()
+        << ",\"p50_ns\":"s << histogram.GetPercentile(50)
+        << ",\"p90_ns\":"s << histogram.GetPercentile(90)
+        << ",\"p99_ns\":"s << histogram.GetPercentile(99)
+        << ",\"max_ns\":"s << histogram.max << '}';
+}
+
+} // namespace
+
+string_view GetMetricName(MetricStage stage) {
+    switch (stage) {
+        case MetricStage::QUERY_PARSE:
+            return "query_parse"sv;
+        case MetricStage::POSTING_TRAVERSAL:
+            return "posting_traversal"sv;
+        case MetricStage::MINUS_FILTER:
+            return "minus_filter"sv;
+        case MetricStage::RANKING:
+            return "ranking"sv;
+        case MetricStage::MATERIALIZATION:
+            return "materialization"sv;
+    }
+    return {};
+}
+
+string_view GetMetricName(MetricCall call) {
+    switch (call) {
+        case MetricCall::FIND_TOP_DOCUMENTS:
+            return "find_top_documents"sv;
+        case MetricCall::MATCH_DOCUMENT:
+            return "match_document"sv;
+        case MetricCall::ADD_DOCUMENT:
+            return "add_document"sv;
+        case MetricCall::ADD_DOCUMENTS:
+            return "add_documents"sv;
+        case MetricCall::REMOVE_DOCUMENT:
+            return "remove_document"sv;
+        case MetricCall::FIND_TOP_DOCUMENTS_BATCH:
+            return "find_top_documents_batch"sv;
+    }
+    return {};
+}
+
+//          LatencyHistogramSnapshot
+
+double LatencyHistogramSnapshot::GetMean() const {
+    return count == 0 ? 0.0 : static_cast<double>(sum) / count;
+}
+
+uint64_t LatencyHistogramSnapshot::GetPercentile(double percentile) const {
+    if (count == 0) {
+        return 0;
+    }
+    const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(ceil(percentile / 100 * count)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < bucket_counts.size(); ++i) {
+        seen += bucket_counts[i];
+        if (seen >= rank) {
+            return std::min(LatencyHistogram::GetBucketUpperBound(i), max);
+        }
+    }
+    return max;
+}
+
+//          LatencyHistogram
+
+size_t LatencyHistogram::GetBucketIndex(uint64_t value) {
+    if (value < SUB_BUCKET_COUNT) {
+        return value;
+    }
+    int exponent = 63;
+    while ((value >> exponent) == 0) {
+        --exponent;
+    }
+    const int shift = exponent - SUB_BUCKET_BITS;
+    const uint64_t sub_bucket = (value >> shift) & (SUB_BUCKET_COUNT - 1);
+    return (shift + 1) * SUB_BUCKET_COUNT + sub_bucket;
+}
+
+uint64_t LatencyHistogram::GetBucketUpperBound(size_t bucket_index) {
+    if (bucket_index < SUB_BUCKET_COUNT) {
+        return bucket_index;
+    }
+    const size_t shift = bucket_index / SUB_BUCKET_COUNT - 1;
+    const uint64_t lower = (SUB_BUCKET_COUNT + bucket_index % SUB_BUCKET_COUNT) << shift;
+    return lower + ((uint64_t{1} << shift) - 1);
+}
+
+void LatencyHistogram::Record(uint64_t value) {
+    bucket_counts_[GetBucketIndex(value)].fetch_add(1, memory_order_relaxed);
+    count_.fetch_add(1, memory_order_relaxed);
+    sum_.fetch_add(value, memory_order_relaxed);
+    uint64_t current_max = max_.load(memory_order_relaxed);
+    while (current_max < value && !max_.compare_exchange_weak(current_max, value, memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogramSnapshot LatencyHistogram::GetSnapshot() const {
+    // счётчики читаются по одному, поэтому при параллельной записи снимок
+    // может разойтись с count на несколько только что записанных значений
+    LatencyHistogramSnapshot snapshot;
+    snapshot.bucket_counts.resize(BUCKET_COUNT);
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        snapshot.bucket_counts[i] = bucket_counts_[i].load(memory_order_relaxed);
+    }
+    snapshot.count = count_.load(memory_order_relaxed);
+    snapshot.sum = sum_.load(memory_order_relaxed);
+    snapshot.max = max_.load(memory_order_relaxed);
+    return snapshot;
+}
+
+void LatencyHistogram::Reset() {
+    for (auto& bucket_count : bucket_counts_) {
+        bucket_count.store(0, memory_order_relaxed);
+    }
+    count_.store(0, memory_order_relaxed);
+    sum_.store(0, memory_order_relaxed);
+    max_.store(0, memory_order_relaxed);
+}
+
+//          SearchMetricsSnapshot
+
+void SearchMetricsSnapshot::PrintText(ostream& out) const {
+    for (size_t i = 0; i < METRIC_CALL_COUNT; ++i) {
+        PrintHistogramText(out, GetMetricName(static_cast<MetricCall>(i)), calls[i]);
+    }
+    for (size_t i = 0; i < METRIC_STAGE_COUNT; ++i) {
+        PrintHistogramText(out, GetMetricName(static_cast<MetricStage>(i)), stages[i]);
+    }
+    out << "postings_scanned: "s << postings_scanned << '\n'
+        << "documents_scored: "s << documents_scored << '\n'
+        << "postings_shared: "s << postings_shared << '\n';
+}
+
+void SearchMetricsSnapshot::PrintJson(ostream& out) const {
+    out << "{\"calls\":{"s;
+    for (size_t i = 0; i < METRIC_CALL_COUNT; ++i) {
+        if (i > 0) {
+            out << ',';
+        }
+        PrintHistogramJson(out, GetMetricName(static_cast<MetricCall>(i)), calls[i]);
+    }
+    out << "},\"stages\":{"s;
+    for (size_t i = 0; i < METRIC_STAGE_COUNT; ++i) {
+        if (i > 0) {
+            out << ',';
+        }
+        PrintHistogramJson(out, GetMetricName(static_cast<MetricStage>(i)), stages[i]);
+    }
+    out << "},\"postings_scanned\":"s << postings_scanned
+        << ",\"documents_scored\":"s << documents_scored
+        << ",\"postings_shared\":"s << postings_shared << '}';
+}
+
+//          SearchMetrics
+
+SearchMetricsSnapshot SearchMetrics::GetSnapshot() const {
+    SearchMetricsSnapshot snapshot;
+    for (size_t i = 0; i < METRIC_STAGE_COUNT; ++i) {
+        snapshot.stages[i] = stages_[i].GetSnapshot();
+    }
+    for (size_t i = 0; i < METRIC_CALL_COUNT; ++i) {
+        snapshot.calls[i] = calls_[i].GetSnapshot();
+    }
+    snapshot.postings_scanned = postings_scanned_.load(memory_order_relaxed);
+    snapshot.documents_scored = documents_scored_.load(memory_order_relaxed);
+    snapshot.postings_shared = postings_shared_.load(memory_order_relaxed);
+    return snapshot;
+}
+
+void SearchMetrics::Reset() {
+    for (LatencyHistogram& histogram : stages_) {
+        histogram.Reset();
+    }
+    for (LatencyHistogram& histogram : calls_) {
+        histogram.Reset();
+    }
+    postings_scanned_.store(0, memory_order_relaxed);
+    documents_scored_.store(0, memory_order_relaxed);
+    postings_shared_.store(0, memory_order_relaxed);
+}
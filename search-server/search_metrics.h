@@ -0,0 +1,156 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+// Сборка с -DSEARCH_SERVER_DISABLE_METRICS убирает замеры совсем: таймеры
+// становятся пустыми, а EnableMetrics ничего не включает
+#ifdef SEARCH_SERVER_DISABLE_METRICS
+inline constexpr bool METRICS_COMPILED = false;
+#else
+inline constexpr bool METRICS_COMPILED = true;
+#endif
+
+// Этапы выполнения поискового запроса
+enum class MetricStage {
+    QUERY_PARSE,
+    POSTING_TRAVERSAL,
+    MINUS_FILTER,
+    RANKING,
+    MATERIALIZATION,
+};
+inline constexpr size_t METRIC_STAGE_COUNT = 5;
+
+// Публичные методы сервера, время которых замеряется целиком
+enum class MetricCall {
+    FIND_TOP_DOCUMENTS,
+    MATCH_DOCUMENT,
+    ADD_DOCUMENT,
+    ADD_DOCUMENTS,
+    REMOVE_DOCUMENT,
+    FIND_TOP_DOCUMENTS_BATCH,
+};
+inline constexpr size_t METRIC_CALL_COUNT = 6;
+
+std::string_view GetMetricName(MetricStage stage);
+std::string_view GetMetricName(MetricCall call);
+
+struct LatencyHistogramSnapshot {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    std::vector<uint64_t> bucket_counts;
+
+    double GetMean() const;
+    // Верхняя граница корзины, в которую попал percentile-й процент значений
+    uint64_t GetPercentile(double percentile) const;
+};
+
+// Гистограмма в духе HDR: на каждую степень двойки по SUB_BUCKET_COUNT
+// корзин, поэтому относительная погрешность не больше 1 / SUB_BUCKET_COUNT
+// при любом масштабе. Запись - несколько атомарных операций без блокировок
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 3;
+    static constexpr uint64_t SUB_BUCKET_COUNT = uint64_t{1} << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    void Record(uint64_t value);
+    LatencyHistogramSnapshot GetSnapshot() const;
+    void Reset();
+
+    static size_t GetBucketIndex(uint64_t value);
+    static uint64_t GetBucketUpperBound(size_t bucket_index);
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> bucket_counts_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+struct SearchMetricsSnapshot {
+    // время в наносекундах
+    std::array<LatencyHistogramSnapshot, METRIC_STAGE_COUNT> stages;
+    std::array<LatencyHistogramSnapshot, METRIC_CALL_COUNT> calls;
+    uint64_t postings_scanned = 0;
+    uint64_t documents_scored = 0;
+    // вхождения, которые пакетный поиск не обходил повторно: их обошёл бы
+    // FindTopDocuments по каждому запросу отдельно
+    uint64_t postings_shared = 0;
+
+    void PrintText(std::ostream& out) const;
+    void PrintJson(std::ostream& out) const;
+};
+
+class SearchMetrics {
+public:
+    LatencyHistogram& GetHistogram(MetricStage stage) {
+        return stages_[static_cast<size_t>(stage)];
+    }
+    LatencyHistogram& GetHistogram(MetricCall call) {
+        return calls_[static_cast<size_t>(call)];
+    }
+
+    void AddPostingsScanned(uint64_t count) {
+        postings_scanned_.fetch_add(count, std::memory_order_relaxed);
+    }
+    void AddDocumentsScored(uint64_t count) {
+        documents_scored_.fetch_add(count, std::memory_order_relaxed);
+    }
+    void AddPostingsShared(uint64_t count) {
+        postings_shared_.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    SearchMetricsSnapshot GetSnapshot() const;
+    void Reset();
+
+private:
+    std::array<LatencyHistogram, METRIC_STAGE_COUNT> stages_;
+    std::array<LatencyHistogram, METRIC_CALL_COUNT> calls_;
+    std::atomic<uint64_t> postings_scanned_{0};
+    std::atomic<uint64_t> documents_scored_{0};
+    std::atomic<uint64_t> postings_shared_{0};
+};
+
+// Замеряет время от создания до разрушения. С нулевым metrics не читает часы
+class MetricsTimer {
+public:
+    template <typename Metric>
+    MetricsTimer(SearchMetrics* metrics, Metric metric) {
+        if constexpr (METRICS_COMPILED) {
+            if (metrics != nullptr) {
+                histogram_ = &metrics->GetHistogram(metric);
+                start_ = std::chrono::steady_clock::now();
+            }
+        }
+    }
+
+    MetricsTimer(const MetricsTimer&) = delete;
+    MetricsTimer& operator=(const MetricsTimer&) = delete;
+
+    ~MetricsTimer() {
+        Stop();
+    }
+
+    // Записывает замер досрочно; повторные вызовы ничего не делают
+    void Stop() {
+        if constexpr (METRICS_COMPILED) {
+            if (histogram_ != nullptr) {
+                const auto duration = std::chrono::steady_clock::now() - start_;
+                histogram_->Record(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+                histogram_ = nullptr;
+            }
+        }
+    }
+
+private:
+    LatencyHistogram* histogram_ = nullptr;
+    std::chrono::steady_clock::time_point start_;
+};
@@ -1,5 +1,17 @@
 #include "search_server.h"
 
+#include <atomic>
+#include <fstream>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "index_snapshot.h"
+#include "snapshot_search_server.h"
+#include "term_intersection.h"
+#include "write_ahead_log.h"
+
 using namespace std;
 
 SearchServer::SearchServer(const string stop_words_text)
@@ -8,126 +20,775 @@ SearchServer::SearchServer(const string stop_words_text)
 {
 }
 
+SearchServer::SearchServer(const SearchServer& other)
+    : stop_words_(other.stop_words_)
+    , terms_(other.terms_)
+    , term_postings_(other.term_postings_)
+    , term_max_freqs_(other.term_max_freqs_)
+    , document_to_ordinal_(other.document_to_ordinal_)
+    , document_ids_(other.document_ids_)
+    , ordinal_to_document_id_(other.ordinal_to_document_id_)
+    , ordinal_to_rating_(other.ordinal_to_rating_)
+    , ordinal_to_status_(other.ordinal_to_status_)
+    , ordinal_to_word_count_(other.ordinal_to_word_count_)
+    , ordinal_to_terms_(other.ordinal_to_terms_)
+    , ordinal_to_fingerprint_(other.ordinal_to_fingerprint_)
+    , removal_mode_(other.removal_mode_)
+    , compaction_threshold_(other.compaction_threshold_)
+    , status_bitmaps_(other.status_bitmaps_)
+    , tombstones_(other.tombstones_)
+    , tombstone_count_(other.tombstone_count_)
+    , term_tombstone_counts_(other.term_tombstone_counts_)
+    , query_evaluation_(other.query_evaluation_)
+    , collection_statistics_(other.collection_statistics_)
+    , query_cache_(other.query_cache_ ? make_unique<QueryCache>(other.query_cache_->GetMaxSize()) : nullptr)
+    , metrics_(other.metrics_ ? make_unique<SearchMetrics>() : nullptr)
+    , log_sequence_(other.log_sequence_)
+    , generation_(other.generation_) {
+    term_bitmaps_.reserve(other.term_bitmaps_.size());
+    for (const auto& bitmap : other.term_bitmaps_) {
+        term_bitmaps_.push_back(bitmap ? make_unique<OrdinalBitmap>(*bitmap) : nullptr);
+    }
+    // ключи частот должны указывать на строки своего словаря
+    for (const auto& [document_id, word_freqs] : other.document_to_word_freqs_) {
+        auto& copy = document_to_word_freqs_[document_id];
+        for (const auto& [word, freq] : word_freqs) {
+            copy.emplace_hint(copy.end(), terms_.GetTerm(terms_.Find(word)), freq);
+        }
+    }
+}
+
+SearchServer::SearchServer(const SnapshotSearchServer& snapshot)
+    : stop_words_([&snapshot] {
+        set<string, less<>> stop_words;
+        for (uint32_t i = 0; i < snapshot.header_->stop_word_count; ++i) {
+            stop_words.emplace(snapshot.GetString(snapshot.stop_words_[i]));
+        }
+        return stop_words;
+    }())
+    , log_sequence_(snapshot.header_->log_sequence) {
+    // Номер документа в снимке становится его порядковым номером, а номер
+    // терма - TermId: термы снимка идут по алфавиту, поэтому массивы термов
+    // документов собираются сразу отсортированными
+    const uint32_t document_count = snapshot.header_->document_count;
+    const uint32_t term_count = snapshot.header_->term_count;
+    term_postings_.resize(term_count);
+    term_bitmaps_.resize(term_count);
+    term_max_freqs_.resize(term_count);
+    ordinal_to_terms_.resize(document_count);
+    vector<vector<uint32_t>> term_counts(document_count);
+    for (uint32_t snapshot_term = 0; snapshot_term < term_count; ++snapshot_term) {
+        const TermId term = terms_.Intern(snapshot.GetString(snapshot.terms_[snapshot_term].text));
+        term_max_freqs_[term] = snapshot.terms_[snapshot_term].max_freq;
+        for (const Posting& posting : snapshot.GetPostings(snapshot_term)) {
+            AddTermPosting(term, posting.document_id, posting.count);
+            ordinal_to_terms_[posting.document_id].push_back(term);
+            term_counts[posting.document_id].push_back(posting.count);
+        }
+    }
+
+    ordinal_to_fingerprint_.resize(document_count);
+    vector<uint32_t> ordinals(document_count);
+    iota(ordinals.begin(), ordinals.end(), 0);
+    for_each(execution::par, ordinals.begin(), ordinals.end(), [this](uint32_t ordinal) {
+        ordinal_to_fingerprint_[ordinal] = ComputeFingerprint(ordinal_to_terms_[ordinal]);
+    });
+
+    for (uint32_t ordinal = 0; ordinal < document_count; ++ordinal) {
+        const SnapshotDocument& document = snapshot.documents_[ordinal];
+        // статус индексирует битовые карты, поэтому проверяется до них
+        if (document.status < 0 || static_cast<size_t>(document.status) >= DOCUMENT_STATUS_COUNT) {
+            throw runtime_error("Snapshot document is corrupted"s);
+        }
+        ordinal_to_document_id_.push_back(document.id);
+        ordinal_to_rating_.push_back(document.rating);
+        ordinal_to_status_.push_back(static_cast<DocumentStatus>(document.status));
+        ordinal_to_word_count_.push_back(document.word_count);
+        SetStatusBit(ordinal, true);
+        // документы снимка идут по возрастанию id
+        document_to_ordinal_.emplace_hint(document_to_ordinal_.end(), document.id, ordinal);
+        document_ids_.emplace_hint(document_ids_.end(), document.id);
+        auto& word_freqs = document_to_word_freqs_.emplace_hint(document_to_word_freqs_.end(), document.id,
+                                                                map<string_view, double>{})->second;
+        const double inv_word_count = 1.0 / document.word_count;
+        for (size_t i = 0; i < ordinal_to_terms_[ordinal].size(); ++i) {
+            word_freqs.emplace_hint(word_freqs.end(), terms_.GetTerm(ordinal_to_terms_[ordinal][i]),
+                                    term_counts[ordinal][i] * inv_word_count);
+        }
+    }
+}
+
 void SearchServer::AddDocument(int document_id, const string_view document, DocumentStatus status, const vector<int>& ratings) {
-    if (!IsValidWord(document)) {
+    MetricsTimer call_timer(metrics_.get(), MetricCall::ADD_DOCUMENT);
+    // буфер слов переиспользуется между вызовами
+    thread_local vector<string_view> words;
+    words.clear();
+    if (!SplitIntoWordsNoStop(document, words)) {
         throw invalid_argument("Document contains special symbols"s);
     } 
-    else if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+    else if ((document_id < 0) || (document_ids_.count(document_id) > 0)) {
         throw invalid_argument("Invalid document_id"s);
     }
-    const auto words = SplitIntoWordsNoStop(document);
+    // запись попадает в журнал раньше, чем в индекс: ошибка журнала не
+    // должна оставить в памяти изменение, которого нет на диске
+    const uint64_t log_sequence = write_ahead_log_ != nullptr
+        ? write_ahead_log_->AppendAddDocument(document_id, document, status, ratings)
+        : log_sequence_;
+    if (document_to_ordinal_.count(document_id) > 0) {
+        // id освобождается от документа, помеченного удалённым
+        PurgeDocument(execution::seq, document_id);
+    }
 
+    const auto ordinal = static_cast<uint32_t>(ordinal_to_document_id_.size());
     const double inv_word_count = 1.0 / static_cast<int>(words.size());
+    auto& word_freqs = document_to_word_freqs_[document_id];
+    map<TermId, uint32_t> term_counts;
     for (const string_view word : words) {
-        word_to_document_freqs_[string(word)][document_id] += inv_word_count;
-        const auto it = word_to_document_freqs_.find(string(word));
-        document_to_word_freqs_[document_id][it->first] += inv_word_count;
+        const TermId term = terms_.Intern(word);
+        if (term == term_postings_.size()) {
+            term_postings_.emplace_back();
+            term_bitmaps_.emplace_back();
+        }
+        if (term == term_max_freqs_.size()) {
+            term_max_freqs_.push_back(0.0);
+        }
+        ++term_counts[term];
+        word_freqs[terms_.GetTerm(term)] += inv_word_count;
+    }
+    for (const auto [term, count] : term_counts) {
+        AddTermPosting(term, ordinal, count);
+        term_max_freqs_[term] = max(term_max_freqs_[term], count * inv_word_count);
     }
-    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status});
+    ordinal_to_document_id_.push_back(document_id);
+    ordinal_to_rating_.push_back(ComputeAverageRating(ratings));
+    ordinal_to_status_.push_back(status);
+    ordinal_to_word_count_.push_back(static_cast<int>(words.size()));
+    SetStatusBit(ordinal, true);
+    auto& document_terms = ordinal_to_terms_.emplace_back();
+    document_terms.reserve(term_counts.size());
+    for (const auto [term, count] : term_counts) {
+        document_terms.push_back(term);
+    }
+    ordinal_to_fingerprint_.push_back(ComputeFingerprint(document_terms));
+    document_to_ordinal_.emplace(document_id, ordinal);
     document_ids_.emplace(document_id);
+    ++generation_;
+    log_sequence_ = log_sequence;
+}
+
+void SearchServer::AddDocuments(const vector<NewDocument>& documents) {
+    AddDocuments(execution::seq, documents);
+}
+
+void SearchServer::AddDocuments(const execution::sequenced_policy& policy, const vector<NewDocument>& documents) {
+    MetricsTimer call_timer(metrics_.get(), MetricCall::ADD_DOCUMENTS);
+    AddDocumentsImpl(policy, documents);
+}
+
+void SearchServer::AddDocuments(const execution::parallel_policy& policy, const vector<NewDocument>& documents) {
+    MetricsTimer call_timer(metrics_.get(), MetricCall::ADD_DOCUMENTS);
+    AddDocumentsImpl(policy, documents);
+}
+
+template<typename ExecutionPolicy>
+void SearchServer::AddDocumentsImpl(const ExecutionPolicy& policy, const vector<NewDocument>& documents) {
+    // Проверки идут до изменения индекса; исключение из параллельного
+    // алгоритма завершило бы программу, поэтому они возвращают bool.
+    // Управляющие символы ищет разбор на слова ниже, он индекс не меняет
+    vector<int> new_ids(documents.size());
+    transform(documents.begin(), documents.end(), new_ids.begin(), [](const NewDocument& document) {
+        return document.id;
+    });
+    sort(policy, new_ids.begin(), new_ids.end());
+    if ((!new_ids.empty() && new_ids.front() < 0)
+        || adjacent_find(new_ids.begin(), new_ids.end()) != new_ids.end()
+        || any_of(new_ids.begin(), new_ids.end(), [this](int id) { return document_ids_.count(id) > 0; })) {
+        throw invalid_argument("Invalid document_id"s);
+    }
+
+    // Пакет делится на части. Каждая часть разбирает свои документы и
+    // нумерует слова в собственном словаре, не трогая общий
+    size_t part_count = 1;
+    if constexpr (!is_same_v<decay_t<ExecutionPolicy>, execution::sequenced_policy>) {
+        part_count = max<size_t>(1, min<size_t>(documents.size(), thread::hardware_concurrency()));
+    }
+    struct DocumentTerms {
+        // пары (терм, число вхождений); до слияния номера термов локальны для части
+        vector<pair<TermId, uint32_t>> term_counts;
+        int word_count = 0;
+    };
+    struct Part {
+        unordered_map<string_view, TermId> word_to_local_term;
+        vector<string_view> local_terms;
+        vector<TermId> local_to_global;
+    };
+    vector<DocumentTerms> document_terms(documents.size());
+    vector<Part> parts(part_count);
+    vector<size_t> part_indexes(part_count);
+    iota(part_indexes.begin(), part_indexes.end(), 0);
+    const auto part_begin = [&documents, part_count](size_t part) {
+        return documents.size() * part / part_count;
+    };
+
+    atomic<bool> has_special_symbols = false;
+    for_each(policy, part_indexes.begin(), part_indexes.end(), [&](size_t part_index) {
+        Part& part = parts[part_index];
+        vector<string_view> words;
+        for (size_t i = part_begin(part_index); i < part_begin(part_index + 1); ++i) {
+            words.clear();
+            if (!SplitIntoWordsNoStop(documents[i].text, words)) {
+                has_special_symbols = true;
+                return;
+            }
+            sort(words.begin(), words.end());
+            DocumentTerms& terms = document_terms[i];
+            terms.word_count = static_cast<int>(words.size());
+            for (size_t j = 0; j < words.size(); ++j) {
+                if (j > 0 && words[j] == words[j - 1]) {
+                    ++terms.term_counts.back().second;
+                    continue;
+                }
+                const auto [it, inserted] = part.word_to_local_term.emplace(
+                    words[j], static_cast<TermId>(part.local_terms.size()));
+                if (inserted) {
+                    part.local_terms.push_back(words[j]);
+                }
+                terms.term_counts.emplace_back(it->second, 1);
+            }
+        }
+    });
+    if (has_special_symbols) {
+        throw invalid_argument("Document contains special symbols"s);
+    }
+    // пакет проверен и попадает в журнал раньше, чем в индекс
+    uint64_t log_sequence = log_sequence_;
+    if (write_ahead_log_ != nullptr) {
+        for (const NewDocument& document : documents) {
+            log_sequence = write_ahead_log_->AppendAddDocument(document.id, document.text, document.status,
+                                                               document.ratings);
+        }
+    }
+    for (const int id : new_ids) {
+        if (document_to_ordinal_.count(id) > 0) {
+            PurgeDocument(execution::seq, id);
+        }
+    }
+
+    // Слияние словарей частей: каждое слово ищется в общем словаре один
+    // раз на часть, а не на каждое вхождение
+    for (Part& part : parts) {
+        part.local_to_global.reserve(part.local_terms.size());
+        for (const string_view word : part.local_terms) {
+            const TermId term = terms_.Intern(word);
+            if (term == term_postings_.size()) {
+                term_postings_.emplace_back();
+                term_bitmaps_.emplace_back();
+                term_max_freqs_.push_back(0.0);
+            }
+            part.local_to_global.push_back(term);
+        }
+    }
+    for_each(policy, part_indexes.begin(), part_indexes.end(), [&](size_t part_index) {
+        const Part& part = parts[part_index];
+        for (size_t i = part_begin(part_index); i < part_begin(part_index + 1); ++i) {
+            auto& term_counts = document_terms[i].term_counts;
+            for (auto& [term, count] : term_counts) {
+                term = part.local_to_global[term];
+            }
+            sort(term_counts.begin(), term_counts.end());
+        }
+    });
+
+    // Инвертированный индекс пакета: вхождения раскладываются по термам
+    // сортировкой подсчётом, после чего списки разных термов пополняются
+    // параллельно - каждый поток пишет только в свои списки. Документы пакета
+    // получают номера подряд в порядке пакета, поэтому вхождения каждого
+    // терма уже упорядочены и дописываются в конец списка
+    const size_t first_ordinal = ordinal_to_document_id_.size();
+    vector<size_t> term_offsets(term_postings_.size() + 1, 0);
+    for (const DocumentTerms& terms : document_terms) {
+        for (const auto& [term, count] : terms.term_counts) {
+            ++term_offsets[term + 1];
+        }
+    }
+    partial_sum(term_offsets.begin(), term_offsets.end(), term_offsets.begin());
+    // пары (номер документа в пакете, число вхождений)
+    vector<pair<uint32_t, uint32_t>> entries(term_offsets.back());
+    {
+        vector<size_t> positions(term_offsets.begin(), term_offsets.end() - 1);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            for (const auto& [term, count] : document_terms[i].term_counts) {
+                entries[positions[term]++] = {static_cast<uint32_t>(i), count};
+            }
+        }
+    }
+    vector<TermId> touched_terms;
+    for (TermId term = 0; term + 1 < term_offsets.size(); ++term) {
+        if (term_offsets[term] != term_offsets[term + 1]) {
+            touched_terms.push_back(term);
+        }
+    }
+    for_each(policy, touched_terms.begin(), touched_terms.end(), [&](TermId term) {
+        const auto first = entries.begin() + term_offsets[term];
+        const auto last = entries.begin() + term_offsets[term + 1];
+        for (auto it = first; it != last; ++it) {
+            const auto [index, count] = *it;
+            AddTermPosting(term, static_cast<uint32_t>(first_ordinal + index), count);
+            term_max_freqs_[term] = max(term_max_freqs_[term], count * (1.0 / document_terms[index].word_count));
+        }
+    });
+
+    // Прямой индекс: узлы внешнего словаря создаются последовательно,
+    // а вложенные словари и массивы термов разных документов заполняются
+    // параллельно
+    ordinal_to_terms_.resize(first_ordinal + documents.size());
+    ordinal_to_fingerprint_.resize(first_ordinal + documents.size());
+    vector<map<string_view, double>*> word_freqs(documents.size());
+    for (size_t i = 0; i < documents.size(); ++i) {
+        word_freqs[i] = &document_to_word_freqs_[documents[i].id];
+    }
+    vector<size_t> indexes(documents.size());
+    iota(indexes.begin(), indexes.end(), 0);
+    for_each(policy, indexes.begin(), indexes.end(), [&](size_t i) {
+        const double inv_word_count = 1.0 / document_terms[i].word_count;
+        auto& terms = ordinal_to_terms_[first_ordinal + i];
+        terms.reserve(document_terms[i].term_counts.size());
+        for (const auto& [term, count] : document_terms[i].term_counts) {
+            terms.push_back(term);
+            word_freqs[i]->emplace(terms_.GetTerm(term), count * inv_word_count);
+        }
+        ordinal_to_fingerprint_[first_ordinal + i] = ComputeFingerprint(terms);
+    });
+
+    for (size_t i = 0; i < documents.size(); ++i) {
+        ordinal_to_document_id_.push_back(documents[i].id);
+        ordinal_to_rating_.push_back(ComputeAverageRating(documents[i].ratings));
+        ordinal_to_status_.push_back(documents[i].status);
+        ordinal_to_word_count_.push_back(document_terms[i].word_count);
+        document_to_ordinal_.emplace(documents[i].id, static_cast<uint32_t>(first_ordinal + i));
+        SetStatusBit(static_cast<uint32_t>(first_ordinal + i), true);
+        document_ids_.emplace(documents[i].id);
+    }
+    ++generation_;
+    log_sequence_ = log_sequence;
+}
+
+void SearchServer::AppendIndex(const SearchServer& other, const set<int>& skipped_ids) {
+    vector<uint32_t> other_ordinals;
+    for (const auto& [document_id, ordinal] : other.document_to_ordinal_) {
+        if (skipped_ids.count(document_id) > 0) {
+            continue;
+        }
+        if (document_ids_.count(document_id) > 0) {
+            throw invalid_argument("Invalid document_id"s);
+        }
+        other_ordinals.push_back(ordinal);
+    }
+    sort(other_ordinals.begin(), other_ordinals.end());
+    for (const uint32_t ordinal : other_ordinals) {
+        if (document_to_ordinal_.count(other.ordinal_to_document_id_[ordinal]) > 0) {
+            PurgeDocument(execution::seq, other.ordinal_to_document_id_[ordinal]);
+        }
+    }
+
+    // Номера переносимых документов идут подряд за уже выданными, поэтому
+    // вхождения каждого терма дописываются в конец его списка
+    constexpr uint32_t NO_ORDINAL = numeric_limits<uint32_t>::max();
+    const auto first_ordinal = static_cast<uint32_t>(ordinal_to_document_id_.size());
+    vector<uint32_t> ordinal_map(other.ordinal_to_document_id_.size(), NO_ORDINAL);
+    for (size_t i = 0; i < other_ordinals.size(); ++i) {
+        ordinal_map[other_ordinals[i]] = first_ordinal + static_cast<uint32_t>(i);
+    }
+    vector<TermId> term_map(other.term_postings_.size(), TermDictionary::NO_TERM);
+    for (TermId other_term = 0; other_term < other.term_postings_.size(); ++other_term) {
+        const PostingList& other_postings = other.term_postings_[other_term];
+        if (other_postings.empty()) {
+            continue;
+        }
+        const TermId term = terms_.Intern(other.terms_.GetTerm(other_term));
+        if (term == term_postings_.size()) {
+            term_postings_.emplace_back();
+            term_bitmaps_.emplace_back();
+            term_max_freqs_.push_back(0.0);
+        }
+        term_map[other_term] = term;
+        for (const Posting& posting : other_postings.GetView()) {
+            if (ordinal_map[posting.document_id] != NO_ORDINAL) {
+                AddTermPosting(term, ordinal_map[posting.document_id], posting.count);
+            }
+        }
+        term_max_freqs_[term] = max(term_max_freqs_[term], other.term_max_freqs_[other_term]);
+    }
+
+    // у термов здесь другие номера, поэтому массив термов документа
+    // пересортировывается, а отпечаток считается заново
+    for (const uint32_t other_ordinal : other_ordinals) {
+        const int document_id = other.ordinal_to_document_id_[other_ordinal];
+        const auto ordinal = static_cast<uint32_t>(ordinal_to_document_id_.size());
+        ordinal_to_document_id_.push_back(document_id);
+        ordinal_to_rating_.push_back(other.ordinal_to_rating_[other_ordinal]);
+        ordinal_to_status_.push_back(other.ordinal_to_status_[other_ordinal]);
+        ordinal_to_word_count_.push_back(other.ordinal_to_word_count_[other_ordinal]);
+        auto& document_terms = ordinal_to_terms_.emplace_back();
+        document_terms.reserve(other.ordinal_to_terms_[other_ordinal].size());
+        for (const TermId other_term : other.ordinal_to_terms_[other_ordinal]) {
+            document_terms.push_back(term_map[other_term]);
+        }
+        sort(document_terms.begin(), document_terms.end());
+        ordinal_to_fingerprint_.push_back(ComputeFingerprint(document_terms));
+        auto& word_freqs = document_to_word_freqs_[document_id];
+        for (const auto& [word, freq] : other.document_to_word_freqs_.at(document_id)) {
+            word_freqs.emplace_hint(word_freqs.end(), terms_.GetTerm(terms_.Find(word)), freq);
+        }
+        SetStatusBit(ordinal, true);
+        document_to_ordinal_.emplace(document_id, ordinal);
+        document_ids_.emplace(document_id);
+    }
+    ++generation_;
+}
+
+void SearchServer::SetQueryEvaluation(QueryEvaluation query_evaluation) {
+    // способы могут расходиться в порядке документов с равной
+    // релевантностью, поэтому выдача другого способа из кеша не берётся
+    if (query_evaluation != query_evaluation_) {
+        query_evaluation_ = query_evaluation;
+        ++generation_;
+    }
+}
+
+void SearchServer::SetCollectionStatistics(const CollectionStatistics* collection_statistics) {
+    collection_statistics_ = collection_statistics;
+}
+
+void SearchServer::EnableQueryCache(size_t max_size) {
+    query_cache_ = max_size > 0 ? make_unique<QueryCache>(max_size) : nullptr;
+}
+
+QueryCacheStats SearchServer::GetQueryCacheStats() const {
+    return query_cache_ ? query_cache_->GetStats() : QueryCacheStats{};
+}
+
+void SearchServer::EnableMetrics(bool enable) {
+    if (enable && METRICS_COMPILED) {
+        if (!metrics_) {
+            metrics_ = make_unique<SearchMetrics>();
+        }
+    } else {
+        metrics_.reset();
+    }
+}
+
+SearchMetricsSnapshot SearchServer::GetMetricsSnapshot() const {
+    return metrics_ ? metrics_->GetSnapshot() : SearchMetricsSnapshot{};
+}
+
+void SearchServer::ResetMetrics() {
+    if (metrics_) {
+        metrics_->Reset();
+    }
 }
 
 int SearchServer::GetDocumentCount() const {
-    return documents_.size();
+    return document_ids_.size();
+}
+
+size_t SearchServer::GetPostingCount() const {
+    size_t result = 0;
+    for (const PostingList& postings : term_postings_) {
+        result += postings.size();
+    }
+    return result;
+}
+
+size_t SearchServer::GetPostingsMemoryUsage() const {
+    size_t result = term_postings_.capacity() * sizeof(PostingList);
+    for (const PostingList& postings : term_postings_) {
+        result += postings.GetMemoryUsage() - sizeof(PostingList);
+    }
+    result += term_bitmaps_.capacity() * sizeof(unique_ptr<OrdinalBitmap>);
+    for (const auto& bitmap : term_bitmaps_) {
+        if (bitmap) {
+            result += bitmap->GetMemoryUsage() + sizeof(OrdinalBitmap);
+        }
+    }
+    return result;
 }
 
 const map<string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
     static const map<string_view, double> empty_words = {};
 
-    if (document_to_word_freqs_.count(document_id)) {
-        return document_to_word_freqs_.at(document_id);
+    if (document_ids_.count(document_id) == 0) {
+        return empty_words;
+    }
+    if (const auto it = document_to_word_freqs_.find(document_id); it != document_to_word_freqs_.end()) {
+        return it->second;
     }
     return empty_words;
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-        return document_status == status;
-        });
+const DocumentFingerprint& SearchServer::GetDocumentFingerprint(int document_id) const {
+    if (document_ids_.count(document_id) == 0) {
+        throw out_of_range("Document "s + to_string(document_id) + " not found"s);
+    }
+    return ordinal_to_fingerprint_[document_to_ordinal_.at(document_id)];
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                                     size_t max_document_count) const {
+    return FindTopDocuments(execution::seq, raw_query, status, max_document_count);
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query) const {
     return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
+vector<vector<Document>> SearchServer::FindTopDocumentsBatch(const vector<string>& raw_queries, DocumentStatus status,
+                                                             size_t max_document_count) const {
+    return FindTopDocumentsBatch(execution::seq, raw_queries, status, max_document_count);
+}
 
-SearchServer::matched_tuple SearchServer::MatchDocument(string_view raw_query, int document_id) const {
-    return MatchDocument(execution::seq, raw_query, document_id);
+vector<vector<Document>> SearchServer::FindTopDocumentsBatch(const execution::sequenced_policy& policy,
+                                                             const vector<string>& raw_queries, DocumentStatus status,
+                                                             size_t max_document_count) const {
+    return FindTopDocumentsBatchImpl(policy, raw_queries, status, max_document_count);
 }
 
-SearchServer::matched_tuple SearchServer::MatchDocument(const execution::sequenced_policy& policy, 
-                                                                 string_view raw_query, int document_id) const {
+vector<vector<Document>> SearchServer::FindTopDocumentsBatch(const execution::parallel_policy& policy,
+                                                             const vector<string>& raw_queries, DocumentStatus status,
+                                                             size_t max_document_count) const {
+    return FindTopDocumentsBatchImpl(policy, raw_queries, status, max_document_count);
+}
 
-    if (document_ids_.count(document_id) == 0)
-    {
-        using namespace std::string_literals;
-        throw std::out_of_range("Sqe out of range"s);
+template <typename ExecutionPolicy>
+vector<vector<Document>> SearchServer::FindTopDocumentsBatchImpl(const ExecutionPolicy& policy,
+                                                                 const vector<string>& raw_queries,
+                                                                 DocumentStatus status,
+                                                                 size_t max_document_count) const {
+    MetricsTimer call_timer(metrics_.get(), MetricCall::FIND_TOP_DOCUMENTS_BATCH);
+    ScratchScope scratch_scope;
+    pmr::memory_resource* const scratch = GetScratchResource();
+    // разбор последовательный, чтобы invalid_argument дошёл до вызывающего
+    pmr::vector<Query> queries(scratch);
+    queries.reserve(raw_queries.size());
+    for (const string& raw_query : raw_queries) {
+        queries.push_back(ParseQuery(raw_query, true));
     }
 
-    const auto query = ParseQuery(raw_query, true);
-    auto status = documents_.at(document_id).status;
-    std::vector<std::string_view> matched_words;
-    for (const std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(string(word)) == 0) {
-            continue;
+    // Запросы с одним и тем же самым длинным списком вхождений попадают в
+    // одну группу: повторный обход таких списков обходится дороже всего
+    pmr::vector<TermId> heaviest_terms(queries.size(), TermDictionary::NO_TERM, scratch);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        size_t heaviest_size = 0;
+        for (const TermId term : queries[i].plus_terms) {
+            if (term_postings_[term].size() >= heaviest_size) {
+                heaviest_size = term_postings_[term].size();
+                heaviest_terms[i] = term;
+            }
         }
-        if (word_to_document_freqs_.at(string(word)).count(document_id)) {
-            return {matched_words, status};
+    }
+    pmr::vector<size_t> order(queries.size(), scratch);
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&heaviest_terms](size_t lhs, size_t rhs) {
+        return heaviest_terms[lhs] < heaviest_terms[rhs];
+    });
+
+    const size_t ordinal_count = max<size_t>(ordinal_to_document_id_.size(), 1);
+    const size_t group_size = clamp<size_t>(BATCH_ACCUMULATOR_SLOTS / ordinal_count, 1, MAX_BATCH_GROUP_SIZE);
+    pmr::vector<size_t> group_firsts(scratch);
+    for (size_t first = 0; first < order.size(); first += group_size) {
+        group_firsts.push_back(first);
+    }
+    vector<vector<Document>> results(queries.size());
+    for_each(policy, group_firsts.begin(), group_firsts.end(), [&](size_t first) {
+        FindTopDocumentsGroup(queries, order.data() + first, min(group_size, order.size() - first), status,
+                              max_document_count, results);
+    });
+    return results;
+}
+
+void SearchServer::FindTopDocumentsGroup(const pmr::vector<Query>& queries, const size_t* indexes, size_t count,
+                                         DocumentStatus status, size_t max_document_count,
+                                         vector<vector<Document>>& results) const {
+    // группы идут и на других потоках, у каждого своя память запроса
+    ScratchScope scratch_scope;
+    pmr::memory_resource* const scratch = GetScratchResource();
+    SearchMetrics* const metrics = metrics_.get();
+    const DocumentFilter status_filter{status};
+    // вхождения плюс-слов, которые обошёл бы поиск по каждому запросу, и
+    // обойдённые на деле; минус-слова обходятся по каждому запросу
+    uint64_t requested_count = 0;
+    uint64_t scanned_count = 0;
+    uint64_t minus_count = 0;
+
+    // проверки документов свои у каждого запроса: минус-слова у них разные
+    pmr::vector<pmr::vector<uint64_t>> excluded(count, scratch);
+    pmr::vector<pmr::vector<uint64_t>> filter_bits(count, scratch);
+    using DocumentCheck = decltype(MakeDocumentCheck(status_filter, queries[0], excluded[0], filter_bits[0]));
+    pmr::vector<DocumentCheck> checks(scratch);
+    checks.reserve(count);
+    // Пары (терм, запрос группы) по возрастанию терма. Релевантность запроса
+    // складывается в том же порядке, что и в FindAllDocuments, поэтому
+    // совпадает с ней до последнего бита
+    pmr::vector<pair<TermId, uint32_t>> term_queries(scratch);
+    for (size_t i = 0; i < count; ++i) {
+        const Query& query = queries[indexes[i]];
+        BuildExclusionBitmap(query, excluded[i]);
+        checks.push_back(MakeDocumentCheck(status_filter, query, excluded[i], filter_bits[i]));
+        for (const TermId term : query.plus_terms) {
+            term_queries.emplace_back(term, static_cast<uint32_t>(i));
+            requested_count += term_postings_[term].size();
+        }
+        for (const TermId term : query.minus_terms) {
+            minus_count += term_postings_[term].size();
         }
     }
+    sort(term_queries.begin(), term_queries.end());
 
-    for (const std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(string(word)) == 0) {
-            continue;
+    MetricsTimer traversal_timer(metrics, MetricStage::POSTING_TRAVERSAL);
+    ScoreAccumulatorLease accumulators(count, ordinal_to_document_id_.size());
+    pmr::vector<uint32_t> term_group(scratch);
+    for (size_t first = 0; first < term_queries.size();) {
+        const TermId term = term_queries[first].first;
+        term_group.clear();
+        for (; first < term_queries.size() && term_queries[first].first == term; ++first) {
+            term_group.push_back(term_queries[first].second);
         }
-        if (word_to_document_freqs_.at(string(word)).count(document_id)) {
-            matched_words.push_back(word);
+        const double inverse_document_freq = ComputeTermInverseDocumentFreq(term);
+        for (const Posting& posting : term_postings_[term].GetView()) {
+            const double score = ComputeTermFreq(posting) * inverse_document_freq;
+            for (const uint32_t i : term_group) {
+                if (checks[i](posting.document_id)) {
+                    accumulators[i].Add(posting.document_id, score);
+                }
+            }
         }
+        scanned_count += term_postings_[term].size();
+    }
+    traversal_timer.Stop();
+
+    MetricsTimer ranking_timer(metrics, MetricStage::RANKING);
+    uint64_t scored_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+        TopDocumentsCollector collector(max_document_count);
+        accumulators[i].ForEach([this, &collector](uint32_t ordinal, double relevance) {
+            collector.Add({ordinal_to_document_id_[ordinal], relevance, ordinal_to_rating_[ordinal]});
+        });
+        scored_count += accumulators[i].GetTouchedCount();
+        results[indexes[i]] = collector.Extract();
     }
+    ranking_timer.Stop();
 
-    return {matched_words, documents_.at(document_id).status};
+    if (metrics != nullptr) {
+        metrics->AddPostingsScanned(scanned_count + minus_count);
+        metrics->AddDocumentsScored(scored_count);
+        metrics->AddPostingsShared(requested_count - scanned_count);
+    }
+}
+
+
+SearchServer::matched_tuple SearchServer::MatchDocument(string_view raw_query, int document_id) const {
+    return MatchDocument(execution::seq, raw_query, document_id);
 }
 
-SearchServer::matched_tuple SearchServer::MatchDocument(const std::execution::parallel_policy& policy, 
-                                                                std::string_view raw_query, int document_id) const {
-    
-    if (!document_ids_.count(document_id))
+SearchServer::matched_tuple SearchServer::MatchDocument(const execution::sequenced_policy& /*policy*/,
+                                                                 string_view raw_query, int document_id) const {
+    MetricsTimer call_timer(metrics_.get(), MetricCall::MATCH_DOCUMENT);
+    ScratchScope scratch;
+
+    if (document_ids_.count(document_id) == 0)
     {
         using namespace std::string_literals;
-        throw std::out_of_range("Par out of range"s);
+        throw std::out_of_range("Sqe out of range"s);
     }
 
-    auto query = ParseQuery(raw_query, false);
-    const auto status = documents_.at(document_id).status;
-    const auto word_checker = [this, document_id](const std::string_view word) {
-        const auto it = word_to_document_freqs_.find(string(word));
-        return it != word_to_document_freqs_.end() && it->second.count(document_id);
-    };
+    return MatchParsedQuery(ParseQuery(raw_query, true), document_to_ordinal_.at(document_id));
+}
+
+// Пересечение нескольких слов запроса с термами одного документа быстрее
+// запуска параллельных алгоритмов, поэтому параллельной версии нечего делить
+SearchServer::matched_tuple SearchServer::MatchDocument(const std::execution::parallel_policy& /*policy*/,
+                                                        std::string_view raw_query, int document_id) const {
+    return MatchDocument(execution::seq, raw_query, document_id);
+}
 
-    if (std::any_of(std::execution::par, query.minus_words.begin(), query.minus_words.end(), word_checker)) {
-        std::vector<std::string_view> m;
-        return {m, status};
+vector<SearchServer::matched_tuple> SearchServer::MatchDocuments(string_view raw_query,
+                                                                 const vector<int>& document_ids) const {
+    return MatchDocuments(execution::seq, raw_query, document_ids);
+}
+
+vector<SearchServer::matched_tuple> SearchServer::MatchDocuments(const execution::sequenced_policy& policy,
+                                                                 string_view raw_query,
+                                                                 const vector<int>& document_ids) const {
+    return MatchDocumentsImpl(policy, raw_query, document_ids);
+}
+
+vector<SearchServer::matched_tuple> SearchServer::MatchDocuments(const execution::parallel_policy& policy,
+                                                                 string_view raw_query,
+                                                                 const vector<int>& document_ids) const {
+    return MatchDocumentsImpl(policy, raw_query, document_ids);
+}
+
+template <typename ExecutionPolicy>
+vector<SearchServer::matched_tuple> SearchServer::MatchDocumentsImpl(const ExecutionPolicy& policy,
+                                                                     string_view raw_query,
+                                                                     const vector<int>& document_ids) const {
+    ScratchScope scratch;
+    pmr::vector<uint32_t> ordinals(document_ids.size(), GetScratchResource());
+    for (size_t i = 0; i < document_ids.size(); ++i) {
+        const auto it = document_to_ordinal_.find(document_ids[i]);
+        if (it == document_to_ordinal_.end() || IsRemoved(it->second)) {
+            throw out_of_range("Document "s + to_string(document_ids[i]) + " not found"s);
+        }
+        ordinals[i] = it->second;
+    }
+
+    const Query query = ParseQuery(raw_query, true);
+    vector<matched_tuple> result(ordinals.size());
+    transform(policy, ordinals.begin(), ordinals.end(), result.begin(), [this, &query](uint32_t ordinal) {
+        return MatchParsedQuery(query, ordinal);
+    });
+    return result;
+}
+
+SearchServer::matched_tuple SearchServer::MatchParsedQuery(const Query& query, uint32_t ordinal) const {
+    const vector<TermId>& document_terms = ordinal_to_terms_[ordinal];
+    vector<string_view> matched_words;
+    const bool has_minus_term = any_of(query.minus_terms.begin(), query.minus_terms.end(), [&](TermId term) {
+        const auto& bitmap = term_bitmaps_[term];
+        return bitmap ? bitmap->Contains(ordinal) : binary_search(document_terms.begin(), document_terms.end(), term);
+    });
+    if (has_minus_term) {
+        return {matched_words, ordinal_to_status_[ordinal]};
     }
 
-    std::vector<std::string_view> matched_words(query.plus_words.size());
-    auto words_end = std::copy_if(std::execution::par,
-        query.plus_words.begin(), query.plus_words.end(),
-        matched_words.begin(),
-        word_checker);
-    std::sort(std::execution::par, matched_words.begin(), words_end);
-    words_end = std::unique(std::execution::par, matched_words.begin(), words_end);
-    matched_words.erase(words_end, matched_words.end());
+    thread_local vector<TermId> matched_terms;
+    matched_terms.clear();
+    IntersectTerms(query.plus_terms, document_terms, matched_terms);
+    matched_words.reserve(matched_terms.size());
+    for (const TermId term : matched_terms) {
+        matched_words.push_back(terms_.GetTerm(term));
+    }
+    // термы упорядочены по TermId, а результат - по алфавиту
+    sort(matched_words.begin(), matched_words.end());
 
-    return {matched_words, status};
+    return {matched_words, ordinal_to_status_[ordinal]};
 }
 
 void SearchServer::RemoveDocument(int document_id) {
-    for (auto& [word, freq]: document_to_word_freqs_.at(document_id)) {
-        word_to_document_freqs_.at(string(word)).erase(document_id);        
+    MetricsTimer call_timer(metrics_.get(), MetricCall::REMOVE_DOCUMENT);
+    if (document_ids_.count(document_id) == 0) {
+        throw out_of_range("Document "s + to_string(document_id) + " not found"s);
     }
-    document_to_word_freqs_.erase(document_id);  
-    document_ids_.erase(document_id);
-    documents_.erase(document_id);
+    const uint64_t log_sequence = write_ahead_log_ != nullptr
+        ? write_ahead_log_->AppendRemoveDocument(document_id)
+        : log_sequence_;
+    if (removal_mode_ == RemovalMode::DEFERRED) {
+        AddTombstone(document_id);
+    } else {
+        PurgeDocument(execution::seq, document_id);
+    }
+    ++generation_;
+    log_sequence_ = log_sequence;
 }
 
 void SearchServer::RemoveDocument(const execution::sequenced_policy& policy, int document_id) {
@@ -135,53 +796,391 @@ void SearchServer::RemoveDocument(const execution::sequenced_policy& policy, int
 }
 
 void SearchServer::RemoveDocument(const execution::parallel_policy& policy, int document_id) {
+    MetricsTimer call_timer(metrics_.get(), MetricCall::REMOVE_DOCUMENT);
+    if (document_ids_.count(document_id) == 0) {
+        return;
+    }
+    const uint64_t log_sequence = write_ahead_log_ != nullptr
+        ? write_ahead_log_->AppendRemoveDocument(document_id)
+        : log_sequence_;
+    if (removal_mode_ == RemovalMode::DEFERRED) {
+        AddTombstone(document_id);
+    } else {
+        PurgeDocument(policy, document_id);
+    }
+    ++generation_;
+    log_sequence_ = log_sequence;
+}
+
+void SearchServer::SetRemovalMode(RemovalMode removal_mode) {
+    removal_mode_ = removal_mode;
+}
 
-    if (!document_to_word_freqs_.count(document_id)) {
+void SearchServer::SetCompactionThreshold(double removed_ratio) {
+    compaction_threshold_ = removed_ratio;
+}
+
+bool SearchServer::IsCompactionDue() const {
+    return compaction_threshold_ > 0 && GetRemovedDocumentRatio() >= compaction_threshold_;
+}
+
+void SearchServer::Compact() {
+    CompactImpl(execution::seq);
+}
+
+void SearchServer::Compact(const execution::sequenced_policy& policy) {
+    CompactImpl(policy);
+}
+
+void SearchServer::Compact(const execution::parallel_policy& policy) {
+    CompactImpl(policy);
+}
+
+double SearchServer::GetRemovedDocumentRatio() const {
+    return document_to_ordinal_.empty() ? 0.0 : static_cast<double>(tombstone_count_) / document_to_ordinal_.size();
+}
+
+void SearchServer::AddTombstone(int document_id) {
+    const uint32_t ordinal = document_to_ordinal_.at(document_id);
+    if (tombstones_.size() <= ordinal) {
+        tombstones_.resize(ordinal_to_document_id_.size());
+    }
+    tombstones_[ordinal] = true;
+    ++tombstone_count_;
+    SetStatusBit(ordinal, false);
+    term_tombstone_counts_.resize(term_postings_.size());
+    for (const TermId term : ordinal_to_terms_[ordinal]) {
+        ++term_tombstone_counts_[term];
+    }
+    document_ids_.erase(document_id);
+}
+
+void SearchServer::SetStatusBit(uint32_t ordinal, bool value) {
+    const size_t word_count = (ordinal_to_document_id_.size() + 63) / 64;
+    for (auto& bitmap : status_bitmaps_) {
+        bitmap.resize(word_count, 0);
+    }
+    const auto status_index = static_cast<size_t>(ordinal_to_status_[ordinal]);
+    if (status_index >= DOCUMENT_STATUS_COUNT) {
         return;
     }
+    const uint64_t bit = uint64_t{1} << (ordinal % 64);
+    if (value) {
+        status_bitmaps_[status_index][ordinal / 64] |= bit;
+    } else {
+        status_bitmaps_[status_index][ordinal / 64] &= ~bit;
+    }
+}
+
+void SearchServer::AddTermPosting(TermId term, uint32_t ordinal, uint32_t count) {
+    term_postings_[term].Add(static_cast<int>(ordinal), count);
+    if (term_bitmaps_[term]) {
+        term_bitmaps_[term]->Add(ordinal);
+    } else if (term_postings_[term].size() >= FREQUENT_TERM_POSTINGS) {
+        RebuildTermBitmap(term);
+    }
+}
+
+void SearchServer::RebuildTermBitmap(TermId term) {
+    auto bitmap = make_unique<OrdinalBitmap>();
+    for (const Posting& posting : term_postings_[term].GetView()) {
+        bitmap->Add(static_cast<uint32_t>(posting.document_id));
+    }
+    term_bitmaps_[term] = move(bitmap);
+}
 
-    std::vector<std::string_view> words(document_to_word_freqs_.at(document_id).size());
-    std::transform(policy,
-        document_to_word_freqs_.at(document_id).begin(), document_to_word_freqs_.at(document_id).end(),
-        words.begin(),
-        [](const auto& p) {
-            return string_view(p.first);
+template <typename ExecutionPolicy>
+void SearchServer::PurgeDocument(const ExecutionPolicy& policy, int document_id) {
+    const auto it = document_to_ordinal_.find(document_id);
+    const uint32_t ordinal = it->second;
+    auto& terms = ordinal_to_terms_[ordinal];
+    // каждый терм встречается один раз, поэтому потоки меняют разные списки
+    for_each(policy, terms.begin(), terms.end(), [&](TermId term) {
+        term_postings_[term].Remove(ordinal);
+        if (term_bitmaps_[term]) {
+            term_bitmaps_[term]->Remove(ordinal);
         }
-    );
-    std::for_each(policy, 
-        words.begin(), 
-        words.end(),
-        [&](const string_view word) {
-            word_to_document_freqs_.at(std::string(word)).erase(document_id);
+    });
+    SetStatusBit(ordinal, false);
+    if (IsRemoved(ordinal)) {
+        tombstones_[ordinal] = false;
+        --tombstone_count_;
+        for (const TermId term : terms) {
+            --term_tombstone_counts_[term];
         }
-    );
-    
+    }
+    vector<TermId>().swap(terms);
+
+    document_to_word_freqs_.erase(document_id);
     document_ids_.erase(document_id);
-    documents_.erase(document_id);
+    document_to_ordinal_.erase(it);
 }
 
-bool SearchServer::IsStopWord(const string_view word) const {
-    return stop_words_.count(string(word)) > 0;
+template <typename ExecutionPolicy>
+void SearchServer::CompactImpl(const ExecutionPolicy& policy) {
+    if (tombstone_count_ == 0) {
+        return;
+    }
+    vector<TermId> affected_terms;
+    for (TermId term = 0; term < term_tombstone_counts_.size(); ++term) {
+        if (term_tombstone_counts_[term] > 0) {
+            affected_terms.push_back(term);
+        }
+    }
+    // Списки переносятся в новое хранилище, а старое освобождается целиком
+    // вместе с дырами, оставленными удалениями. Затронутый список
+    // пересобирается: это один проход вместо перекодирования блока на каждое
+    // удалённое вхождение
+    PostingStore compacted;
+    compacted.resize(term_postings_.size());
+    vector<TermId> terms(term_postings_.size());
+    iota(terms.begin(), terms.end(), 0);
+    for_each(policy, terms.begin(), terms.end(), [this, &compacted](TermId term) {
+        if (term >= term_tombstone_counts_.size() || term_tombstone_counts_[term] == 0) {
+            compacted[term] = term_postings_[term];
+            return;
+        }
+        for (const Posting& posting : term_postings_[term].GetView()) {
+            if (!IsRemoved(posting.document_id)) {
+                compacted[term].Add(posting.document_id, posting.count);
+            }
+        }
+    });
+    term_postings_ = move(compacted);
+    for_each(policy, affected_terms.begin(), affected_terms.end(), [this](TermId term) {
+        if (term_bitmaps_[term]) {
+            RebuildTermBitmap(term);
+        }
+        term_tombstone_counts_[term] = 0;
+    });
+
+    for (uint32_t ordinal = 0; ordinal < tombstones_.size(); ++ordinal) {
+        if (tombstones_[ordinal]) {
+            const int document_id = ordinal_to_document_id_[ordinal];
+            vector<TermId>().swap(ordinal_to_terms_[ordinal]);
+            document_to_word_freqs_.erase(document_id);
+            document_to_ordinal_.erase(document_id);
+        }
+    }
+    tombstones_.assign(tombstones_.size(), false);
+    tombstone_count_ = 0;
 }
 
-bool SearchServer::IsValidWord(const string_view word) {
-    // A valid word must not contain special characters
-    return none_of(word.begin(), word.end(), [](char c) {
-        return c >= '\0' && c < ' ';
+void SearchServer::SaveSnapshot(const string& path) const {
+    // В снимке документы идут по возрастанию id, и списки вхождений
+    // переписываются с порядковых номеров на номера в этой таблице
+    vector<SnapshotDocument> documents;
+    documents.reserve(document_ids_.size());
+    vector<int> ordinal_to_rank(ordinal_to_document_id_.size(), -1);
+    for (const auto& [document_id, ordinal] : document_to_ordinal_) {
+        if (!IsRemoved(ordinal)) {
+            ordinal_to_rank[ordinal] = static_cast<int>(documents.size());
+            documents.push_back({document_id, ordinal_to_rating_[ordinal],
+                                 static_cast<int32_t>(ordinal_to_status_[ordinal]), ordinal_to_word_count_[ordinal]});
+        }
+    }
+
+    string strings;
+    const auto add_string = [&strings](string_view text) {
+        const SnapshotString result{static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(text.size())};
+        strings += text;
+        return result;
+    };
+
+    vector<TermId> sorted_terms(terms_.GetTermCount());
+    iota(sorted_terms.begin(), sorted_terms.end(), 0);
+    sort(sorted_terms.begin(), sorted_terms.end(), [this](TermId lhs, TermId rhs) {
+        return terms_.GetTerm(lhs) < terms_.GetTerm(rhs);
     });
+
+    vector<SnapshotTerm> terms;
+    vector<PostingBlockHeader> blocks;
+    vector<uint8_t> postings;
+    vector<Posting> ranked;
+    for (const TermId term : sorted_terms) {
+        if (term_postings_[term].empty()) {
+            continue;
+        }
+        ranked.clear();
+        for (const Posting& posting : term_postings_[term].GetView()) {
+            if (!IsRemoved(posting.document_id)) {
+                ranked.push_back({ordinal_to_rank[posting.document_id], posting.count});
+            }
+        }
+        if (ranked.empty()) {
+            continue;
+        }
+        sort(ranked.begin(), ranked.end(), [](const Posting& lhs, const Posting& rhs) {
+            return lhs.document_id < rhs.document_id;
+        });
+        PostingList ranked_postings;
+        for (const Posting& posting : ranked) {
+            ranked_postings.Add(posting.document_id, posting.count);
+        }
+        SnapshotTerm snapshot_term{add_string(terms_.GetTerm(term)),
+                                   static_cast<uint32_t>(blocks.size()),
+                                   static_cast<uint32_t>(ranked_postings.GetBlocks().size()),
+                                   postings.size(),
+                                   static_cast<uint32_t>(ranked_postings.size()),
+                                   0,
+                                   term_max_freqs_[term]};
+        terms.push_back(snapshot_term);
+        blocks.insert(blocks.end(), ranked_postings.GetBlocks().begin(), ranked_postings.GetBlocks().end());
+        postings.insert(postings.end(), ranked_postings.GetData().begin(), ranked_postings.GetData().end());
+    }
+
+    vector<SnapshotString> stop_words;
+    for (const string& word : stop_words_) {
+        stop_words.push_back(add_string(word));
+    }
+
+    // снимок пишется рядом и подменяет старый переименованием: при падении
+    // на диске остаётся либо старый снимок, либо новый целиком
+    const string temp_path = path + ".tmp"s;
+    ofstream out(temp_path, ios::binary | ios::trunc);
+    if (!out) {
+        throw runtime_error("Cannot create snapshot file "s + temp_path);
+    }
+    SnapshotHeader header{};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    uint64_t offset = sizeof(header);
+    uint64_t body_checksum = ComputeSnapshotChecksum(nullptr, 0);
+    const auto write_section = [&out, &offset, &body_checksum](const void* data, size_t size) {
+        static const char padding[8] = {};
+        const uint64_t section_offset = offset;
+        const size_t padding_size = (8 - size % 8) % 8;
+        out.write(static_cast<const char*>(data), size);
+        out.write(padding, padding_size);
+        body_checksum = ComputeSnapshotChecksum(data, size, body_checksum);
+        body_checksum = ComputeSnapshotChecksum(padding, padding_size, body_checksum);
+        offset += size + padding_size;
+        return section_offset;
+    };
+
+    header.documents_offset = write_section(documents.data(), documents.size() * sizeof(SnapshotDocument));
+    header.terms_offset = write_section(terms.data(), terms.size() * sizeof(SnapshotTerm));
+    header.stop_words_offset = write_section(stop_words.data(), stop_words.size() * sizeof(SnapshotString));
+    header.blocks_offset = write_section(blocks.data(), blocks.size() * sizeof(PostingBlockHeader));
+    header.postings_offset = write_section(postings.data(), postings.size());
+    header.strings_offset = write_section(strings.data(), strings.size());
+
+    copy(std::begin(SNAPSHOT_MAGIC), std::end(SNAPSHOT_MAGIC), header.magic);
+    header.version = SNAPSHOT_VERSION;
+    header.header_size = sizeof(header);
+    header.file_size = offset;
+    header.body_checksum = body_checksum;
+    header.document_count = static_cast<uint32_t>(documents.size());
+    header.term_count = static_cast<uint32_t>(terms.size());
+    header.stop_word_count = static_cast<uint32_t>(stop_words.size());
+    header.block_count = static_cast<uint32_t>(blocks.size());
+    header.postings_size = postings.size();
+    header.strings_size = strings.size();
+    header.log_sequence = log_sequence_;
+    header.header_checksum = ComputeSnapshotChecksum(&header, sizeof(header));
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.close();
+    if (!out) {
+        throw runtime_error("Cannot write snapshot file "s + temp_path);
+    }
+    // Снимок должен оказаться на диске раньше, чем WriteAheadLog::Truncate
+    // отрежет вошедшие в него записи: иначе после сбоя ОС не останется ни тех,
+    // ни других
+    const int fd = open(temp_path.c_str(), O_WRONLY);
+    const bool synced = fd >= 0 && fsync(fd) == 0;
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (!synced || rename(temp_path.c_str(), path.c_str()) != 0) {
+        throw runtime_error("Cannot write snapshot file "s + path);
+    }
+    SyncDirectory(path);
+}
+
+void SearchServer::SetWriteAheadLog(WriteAheadLog* write_ahead_log) {
+    write_ahead_log_ = write_ahead_log;
+}
+
+uint64_t SearchServer::GetLogSequence() const {
+    return log_sequence_;
+}
+
+void SearchServer::SetLogSequence(uint64_t log_sequence) {
+    log_sequence_ = log_sequence;
 }
 
-vector<string_view> SearchServer::SplitIntoWordsNoStop(const string_view text) const {
-    vector<string_view> words;
-    for (const string_view word : SplitIntoWords(text)) {
-        if (!IsValidWord(word)) {
-            throw invalid_argument("Word "s + string(word) + " is invalid"s);
+void SearchServer::ReplayWriteAheadLog(const string& path) {
+    if (write_ahead_log_ != nullptr) {
+        throw logic_error("Write-ahead log is replayed into a logged index"s);
+    }
+    const LogContents log = WriteAheadLog::Read(path);
+    // Записи между снимком и началом журнала потеряны: снимок старше
+    // журнала или журнал отрезан без снимка с его записями
+    if (log.base_sequence > log_sequence_) {
+        throw runtime_error("Write-ahead log starts after record "s + to_string(log.base_sequence)
+                            + ", index ends at record "s + to_string(log_sequence_));
+    }
+    const vector<LogRecord>& records = log.records;
+    unordered_map<int, size_t> last_records;
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (records[i].sequence > log_sequence_) {
+            last_records[records[i].document_id] = i;
+        }
+    }
+
+    // Документ, о котором есть запись, целиком определяется последней из
+    // них, поэтому его прежняя версия удаляется. Удаления только помечают
+    // документы, а вычищаются они одним сжатием
+    const RemovalMode removal_mode = removal_mode_;
+    removal_mode_ = RemovalMode::DEFERRED;
+    vector<size_t> added;
+    for (const auto [document_id, index] : last_records) {
+        if (document_ids_.count(document_id) > 0) {
+            RemoveDocument(execution::par, document_id);
         }
-        if (!IsStopWord(word)) {
-            words.push_back(word);
+        if (records[index].operation == LogOperation::ADD_DOCUMENT) {
+            added.push_back(index);
         }
     }
-    return words;
+    removal_mode_ = removal_mode;
+    if (removal_mode_ == RemovalMode::IMMEDIATE) {
+        Compact(execution::par);
+    }
+    // документы получают порядковые номера в порядке журнала
+    sort(added.begin(), added.end());
+    vector<NewDocument> documents;
+    documents.reserve(added.size());
+    for (const size_t index : added) {
+        const LogRecord& record = records[index];
+        documents.push_back({record.document_id, record.text, record.status, record.ratings});
+    }
+    AddDocuments(execution::par, documents);
+    if (!records.empty()) {
+        log_sequence_ = max(log_sequence_, records.back().sequence);
+    }
+}
+
+bool SearchServer::IsStopWord(const string_view word) const {
+    return stop_words_.count(word) > 0;
+}
+
+bool SearchServer::IsValidWord(const string_view word) {
+    return ::IsValidWord(word);
+}
+
+bool SearchServer::SplitIntoWordsNoStop(const string_view text, vector<string_view>& words) const {
+    const size_t first = words.size();
+    if (!SplitIntoWords(text, words)) {
+        return false;
+    }
+    if (!stop_words_.empty()) {
+        words.erase(remove_if(words.begin() + first, words.end(), [this](string_view word) {
+            return IsStopWord(word);
+        }), words.end());
+    }
+    return true;
 }
 
 void AddDocument(SearchServer& search_server, int document_id, const string& document, DocumentStatus status,
@@ -210,42 +1209,83 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(string_view text) const {
         is_minus = true;
         word = word.substr(1);
     }
-    if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
-        throw invalid_argument("Query word "s + word.data() + " is invalid");
+    if (word.empty() || word[0] == '-') {
+        throw invalid_argument("Query word "s + string(word) + " is invalid"s);
     }
 
     return {word, is_minus, IsStopWord(word)};
 }
 
 SearchServer::Query SearchServer::ParseQuery(string_view text, bool sort_flag) const {
+    MetricsTimer timer(metrics_.get(), MetricStage::QUERY_PARSE);
     Query result;
-    
-    for (const std::string_view word : SplitIntoWords(text)) {
+    thread_local vector<string_view> words;
+    words.clear();
+    if (!SplitIntoWords(text, words)) {
+        throw invalid_argument("Query contains special symbols"s);
+    }
+    for (const std::string_view word : words) {
         const auto query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                result.minus_words.push_back(query_word.data);
-            } else {
-                result.plus_words.push_back(query_word.data);
-            }
+        if (query_word.is_stop) {
+            continue;
+        }
+        const TermId term = terms_.Find(query_word.data);
+        if (term == TermDictionary::NO_TERM) {
+            continue;
+        }
+        if (query_word.is_minus) {
+            result.minus_terms.push_back(term);
+        } else {
+            result.plus_terms.push_back(term);
         }
     }
 
     if (sort_flag) {
-        sort(execution::seq, result.minus_words.begin(), result.minus_words.end());
-        sort(execution::seq, result.plus_words.begin(), result.plus_words.end());
+        sort(execution::seq, result.minus_terms.begin(), result.minus_terms.end());
+        sort(execution::seq, result.plus_terms.begin(), result.plus_terms.end());
 
-        auto it1 = unique(execution::seq, result.minus_words.begin(), result.minus_words.end());
-        auto it2 = unique(execution::seq, result.plus_words.begin(), result.plus_words.end());
+        auto it1 = unique(execution::seq, result.minus_terms.begin(), result.minus_terms.end());
+        auto it2 = unique(execution::seq, result.plus_terms.begin(), result.plus_terms.end());
 
-        result.minus_words.erase(it1, result.minus_words.end());
-        result.plus_words.erase(it2, result.plus_words.end());
+        result.minus_terms.erase(it1, result.minus_terms.end());
+        result.plus_terms.erase(it2, result.plus_terms.end());
     }
    
     return result;
 }
 
-// Existence required
-double SearchServer::ComputeWordInverseDocumentFreq(const string_view word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(string(word)).size());
+double SearchServer::ComputeTermInverseDocumentFreq(TermId term) const {
+    if (collection_statistics_ != nullptr) {
+        return collection_statistics_->ComputeInverseDocumentFreq(terms_.GetTerm(term));
+    }
+    size_t document_freq = term_postings_[term].size();
+    if (term < term_tombstone_counts_.size()) {
+        document_freq -= term_tombstone_counts_[term];
+    }
+    return log(GetDocumentCount() * 1.0 / document_freq);
+}
+
+void SearchServer::BuildExclusionBitmap(const Query& query, pmr::vector<uint64_t>& excluded) const {
+    excluded.clear();
+    if (query.minus_terms.empty()) {
+        return;
+    }
+    excluded.assign((ordinal_to_document_id_.size() + 63) / 64, 0);
+    for (const TermId term : query.minus_terms) {
+        if (term_bitmaps_[term]) {
+            term_bitmaps_[term]->OrInto(excluded.data(), excluded.size());
+            continue;
+        }
+        for (const Posting& posting : term_postings_[term].GetView()) {
+            excluded[posting.document_id / 64] |= uint64_t{1} << (posting.document_id % 64);
+        }
+    }
+}
+
+uint64_t SearchServer::GetGeneration() const {
+    return generation_ + (collection_statistics_ != nullptr ? collection_statistics_->GetGeneration() : 0);
+}
+
+double SearchServer::ComputeTermFreq(const Posting& posting) const {
+    return posting.count * (1.0 / ordinal_to_word_count_[posting.document_id]);
 }
\ No newline at end of file
@@ -1,8 +1,13 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <execution>
+#include <limits>
 #include <map>
+#include <memory>
+#include <memory_resource>
+#include <numeric>
 #include <set>
 #include <stdexcept>
 #include <string>
@@ -10,44 +15,133 @@
 #include <cmath>
 #include <stack> 
 #include <string_view>
+#include <thread>
+#include <type_traits>
 
+#include "arena.h"
+#include "collection_statistics.h"
 #include "document.h"
+#include "document_filter.h"
+#include "document_fingerprint.h"
+#include "ordinal_bitmap.h"
 #include "string_processing.h"
-#include "concurrent_map.h"
+#include "posting_list.h"
+#include "query_cache.h"
+#include "score_accumulator.h"
+#include "search_metrics.h"
+#include "term_dictionary.h"
+#include "top_documents.h"
+
+class SnapshotSearchServer;
+class WriteAheadLog;
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
-const double EPSILON = 1e-6;
+
+// EXHAUSTIVE считает релевантность всех подходящих документов.
+// MAX_SCORE обходит документы в порядке добавления и пропускает те, что по
+// верхним оценкам вклада слов запроса не могут попасть в выдачу
+enum class QueryEvaluation {
+    EXHAUSTIVE,
+    MAX_SCORE,
+};
+
+// IMMEDIATE сразу вычищает удалённый документ из списков вхождений.
+// DEFERRED только помечает его удалённым: поиск такие документы пропускает,
+// а из списков они вычищаются при сжатии индекса
+enum class RemovalMode {
+    IMMEDIATE,
+    DEFERRED,
+};
 
 class SearchServer {
 public:
     template <typename StringContainer>
     explicit SearchServer(const StringContainer& stop_words);
     explicit SearchServer(const std::string stop_words_text);
+    // Изменяемый индекс с документами снимка и его GetLogSequence. Списки
+    // вхождений и таблица документов переносятся без разбора текстов
+    explicit SearchServer(const SnapshotSearchServer& snapshot);
+    // Копирует индекс и настройки. Кеш и метрики копия заводит пустыми, а
+    // журнал не наследует: две записи в один журнал перепутали бы номера
+    SearchServer(const SearchServer& other);
+    SearchServer(SearchServer&&) = default;
 
     void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
 
+    // Добавляет пакет документов: разбор текстов и построение частичных
+    // индексов идут параллельно, затем они сливаются в индекс за один проход.
+    // При ошибке в любом документе индекс не меняется
+    void AddDocuments(const std::vector<NewDocument>& documents);
+    void AddDocuments(const std::execution::sequenced_policy& policy, const std::vector<NewDocument>& documents);
+    void AddDocuments(const std::execution::parallel_policy& policy, const std::vector<NewDocument>& documents);
+
+    // Дописывает документы other, кроме skipped_ids, переиспользуя его списки
+    // вхождений без повторного разбора текстов; порядок документов other
+    // сохраняется. Пометки удалённых в other не читаются, поэтому other можно
+    // в это время помечать удалёнными из другого потока, а его удалённые
+    // документы передаются в skipped_ids. Живые id не должны совпадать
+    void AppendIndex(const SearchServer& other, const std::set<int>& skipped_ids);
+
     template <typename ExecutionPolicy, typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, 
-                                                    DocumentPredicate document_predicate) const;
+                                                    DocumentPredicate document_predicate,
+                                                    size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
     template<typename ExecutionPolicy>
-    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status,
+                                           size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
     template <typename ExecutionPolicy> 
     std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query) const;
 
     template <typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
-    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                           size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT) const;
     std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
 
+    // Пакетный поиск с общим обходом: запросы разбираются сразу все и
+    // делятся на группы, внутри группы список вхождений каждого терма
+    // обходится один раз, а вклад вхождения получают все запросы группы с
+    // этим термом. Выдача та же, что у FindTopDocuments по каждому запросу;
+    // кеш результатов не используется
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(
+        const std::vector<std::string>& raw_queries, DocumentStatus status = DocumentStatus::ACTUAL,
+        size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(
+        const std::execution::sequenced_policy& policy, const std::vector<std::string>& raw_queries,
+        DocumentStatus status = DocumentStatus::ACTUAL, size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(
+        const std::execution::parallel_policy& policy, const std::vector<std::string>& raw_queries,
+        DocumentStatus status = DocumentStatus::ACTUAL, size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    void SetQueryEvaluation(QueryEvaluation query_evaluation);
+    // IDF будет считаться по статистике всей коллекции, а не только по
+    // документам этого сервера. Статистика должна пережить сервер
+    void SetCollectionStatistics(const CollectionStatistics* collection_statistics);
+
+    // Включает кеш результатов на max_size запросов, 0 - выключает.
+    // Кешируются только запросы с фильтром по статусу: произвольный
+    // предикат нельзя сравнить с другим
+    void EnableQueryCache(size_t max_size);
+    QueryCacheStats GetQueryCacheStats() const;
+
+    // Включает сбор задержек по этапам поиска и публичным вызовам и
+    // счётчиков обработанных вхождений; при выключении собранное теряется.
+    // Выключенный сбор стоит одной проверки указателя на этап
+    void EnableMetrics(bool enable);
+    // Пустой снимок, если сбор выключен
+    SearchMetricsSnapshot GetMetricsSnapshot() const;
+    void ResetMetrics();
+
     int GetDocumentCount() const;
     
-    std::set<int>::const_iterator begin() {
+    std::set<int>::const_iterator begin() const {
         return document_ids_.begin();
     }
 
-    std::set<int>::const_iterator end() {
+    std::set<int>::const_iterator end() const {
         return document_ids_.end();
     }
 
@@ -58,27 +152,140 @@ public:
     matched_tuple MatchDocument(const std::execution::parallel_policy& policy, 
                                                                  std::string_view raw_query, int document_id) const;
 
+    // Сопоставляет запрос с каждым из документов: запрос разбирается один
+    // раз. Если какого-то документа нет, бросает out_of_range
+    std::vector<matched_tuple> MatchDocuments(std::string_view raw_query, const std::vector<int>& document_ids) const;
+    std::vector<matched_tuple> MatchDocuments(const std::execution::sequenced_policy& policy,
+                                              std::string_view raw_query, const std::vector<int>& document_ids) const;
+    std::vector<matched_tuple> MatchDocuments(const std::execution::parallel_policy& policy,
+                                              std::string_view raw_query, const std::vector<int>& document_ids) const;
+
     const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    // Отпечаток набора слов, посчитанный при добавлении документа
+    const DocumentFingerprint& GetDocumentFingerprint(int document_id) const;
 
     void RemoveDocument(int document_id);
     void RemoveDocument(const std::execution::sequenced_policy& policy, int document_id);
 	void RemoveDocument(const std::execution::parallel_policy& policy, int document_id);
 
+    void SetRemovalMode(RemovalMode removal_mode);
+    // Порог доли помеченных удалёнными документов, после которого стоит
+    // вызвать Compact; 0 - порога нет. RemoveDocument сам не сжимает: сжатие
+    // занимает время, сравнимое с построением индекса, поэтому его запускает
+    // владелец по IsCompactionDue - сам или в фоновом потоке, как
+    // ConcurrentSearchServer
+    void SetCompactionThreshold(double removed_ratio);
+    bool IsCompactionDue() const;
+    // Вычищает из индекса документы, помеченные удалёнными. Результаты
+    // поиска не меняются
+    void Compact();
+    void Compact(const std::execution::sequenced_policy& policy);
+    void Compact(const std::execution::parallel_policy& policy);
+    // Доля помеченных удалёнными среди всех документов, ещё занимающих индекс
+    double GetRemovedDocumentRatio() const;
+
+    // Записывает индекс в файл, который открывает SnapshotSearchServer.
+    // Файл подменяется атомарно и синхронизируется с диском вместе с
+    // каталогом, в снимок попадает GetLogSequence
+    void SaveSnapshot(const std::string& path) const;
+
+    // Добавления и удаления документов дописываются в журнал после проверки
+    // аргументов, но до изменения индекса: если журнал бросил исключение,
+    // индекс не изменился. Из пакета AddDocuments при ошибке журнала в нём
+    // может остаться начало, которое применит ReplayWriteAheadLog. nullptr
+    // отключает журнал. Журнал должен пережить сервер
+    void SetWriteAheadLog(WriteAheadLog* write_ahead_log);
+    // Номер последней записи журнала, отражённой в индексе
+    uint64_t GetLogSequence() const;
+    void SetLogSequence(uint64_t log_sequence);
+    // Применяет записи журнала новее GetLogSequence. Изменения разных
+    // документов перестановочны, поэтому для каждого документа берётся
+    // только последняя запись о нём, а итоговые добавления идут одним
+    // параллельным пакетом. Вызывается до SetWriteAheadLog. Если журнал
+    // начинается позже GetLogSequence, часть записей потеряна и бросается
+    // runtime_error
+    void ReplayWriteAheadLog(const std::string& path);
+
+    size_t GetPostingCount() const;
+    // Память, занятая списками вхождений, в байтах
+    size_t GetPostingsMemoryUsage() const;
+
 private:
-    struct DocumentData {
-        int rating;
-        DocumentStatus status;
-    };
     const std::set<std::string, std::less<>> stop_words_;
-    std::map<std::string, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, DocumentData> documents_;
+    TermDictionary terms_;
+    // инвертированный индекс, позиция - TermId. Списки хранят не id
+    // документов, а их порядковые номера
+    PostingStore term_postings_;
+    // У частых термов номера документов дублируются сжатой битовой картой:
+    // минус-слово по ней исключает документы, не разбирая список вхождений.
+    // nullptr, пока у терма меньше FREQUENT_TERM_POSTINGS вхождений
+    std::vector<std::unique_ptr<OrdinalBitmap>> term_bitmaps_;
+    // максимальная частота терма в документе; при удалении документов не
+    // уменьшается и остаётся верхней оценкой
+    std::vector<double> term_max_freqs_;
+    // Порядковый номер документа - плотный индекс, выдаваемый при добавлении.
+    // Содержит и помеченные удалёнными документы, пока их не вычистит сжатие
+    std::map<int, uint32_t> document_to_ordinal_;
+    // только живые документы
     std::set<int> document_ids_;
+    // Таблица документов по столбцам, индекс - порядковый номер. Номера не
+    // переиспользуются, у удалённых документов остаются старые значения
+    std::vector<int> ordinal_to_document_id_;
+    std::vector<int> ordinal_to_rating_;
+    std::vector<DocumentStatus> ordinal_to_status_;
+    std::vector<int> ordinal_to_word_count_;
+    // различные термы документа по возрастанию, индекс - порядковый номер;
+    // у удалённых документов массив пуст
+    std::vector<std::vector<TermId>> ordinal_to_terms_;
+    // отпечаток набора термов по порядковому номеру; у удалённых документов
+    // остаётся, но не используется
+    std::vector<DocumentFingerprint> ordinal_to_fingerprint_;
+    RemovalMode removal_mode_ = RemovalMode::IMMEDIATE;
+    double compaction_threshold_ = 0.0;
+    // живые документы с данным статусом, бит - порядковый номер; карты
+    // покрывают все выданные номера
+    std::array<std::vector<uint64_t>, DOCUMENT_STATUS_COUNT> status_bitmaps_;
+    // пометки удалённых документов по порядковому номеру; короче числа
+    // документов, если последние добавленные не удалялись
+    std::vector<bool> tombstones_;
+    size_t tombstone_count_ = 0;
+    // сколько вхождений терма принадлежат помеченным документам: они не
+    // должны влиять на IDF
+    std::vector<uint32_t> term_tombstone_counts_;
+    // ключи указывают на строки в terms_, нужен только для GetWordFrequencies
     std::map<int, std::map<std::string_view, double>> document_to_word_freqs_;
+    QueryEvaluation query_evaluation_ = QueryEvaluation::EXHAUSTIVE;
+    const CollectionStatistics* collection_statistics_ = nullptr;
+    std::unique_ptr<QueryCache> query_cache_;
+    std::unique_ptr<SearchMetrics> metrics_;
+    WriteAheadLog* write_ahead_log_ = nullptr;
+    uint64_t log_sequence_ = 0;
+    // растёт при каждом изменении индекса и смене способа вычисления запросов,
+    // по нему кеш отличает устаревшие записи
+    uint64_t generation_ = 0;
+
+    static constexpr size_t FREQUENT_TERM_POSTINGS = 1024;
+    // В группе пакетного поиска столько запросов, чтобы их накопители вместе
+    // занимали не больше BATCH_ACCUMULATOR_SLOTS ячеек и помещались в кеш:
+    // с большими группами промахи по накопителям съедают выигрыш от общего
+    // обхода
+    static constexpr size_t BATCH_ACCUMULATOR_SLOTS = size_t{1} << 17;
+    static constexpr size_t MAX_BATCH_GROUP_SIZE = 256;
 
     bool IsStopWord(const std::string_view word) const;
+    bool IsRemoved(uint32_t ordinal) const {
+        return ordinal < tombstones_.size() && tombstones_[ordinal];
+    }
+    void SetStatusBit(uint32_t ordinal, bool value);
+    // Добавляет вхождение в список терма и в его битовую карту; карта
+    // заводится, как только терм становится частым
+    void AddTermPosting(TermId term, uint32_t ordinal, uint32_t count);
+    void RebuildTermBitmap(TermId term);
     static bool IsValidWord(const std::string_view word);
 
-    std::vector<std::string_view> SplitIntoWordsNoStop(const std::string_view text) const;
+    // Дописывает в words слова текста без стоп-слов; false - если в тексте
+    // есть управляющие символы
+    bool SplitIntoWordsNoStop(const std::string_view text, std::vector<std::string_view>& words) const;
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
     struct QueryWord {
@@ -89,20 +296,72 @@ private:
 
     QueryWord ParseQueryWord(const std::string_view text) const;
 
+    // Слова, отсутствующие в индексе, в запрос не попадают:
+    // они не могут ни найти документ, ни исключить его. Термы лежат в памяти
+    // запроса, поэтому Query не должен пережить ScratchScope, в котором создан
     struct Query {
-        std::vector<std::string_view> plus_words;
-        std::vector<std::string_view> minus_words;
+        std::pmr::vector<TermId> plus_terms{GetScratchResource()};
+        std::pmr::vector<TermId> minus_terms{GetScratchResource()};
     };
 
     Query ParseQuery(const std::string_view text, bool sort_flag) const;
-    Query ParseQuery(const std::execution::parallel_policy& policy,
-                                            const std::string_view text) const;
 
-    double ComputeWordInverseDocumentFreq(const std::string_view word) const;
+    double ComputeTermInverseDocumentFreq(TermId term) const;
+    // Плотная карта документов с минус-словами запроса, бит - порядковый
+    // номер. Пуста, если минус-слов нет
+    void BuildExclusionBitmap(const Query& query, std::pmr::vector<uint64_t>& excluded) const;
+    // Поколение данных, от которых зависит выдача: индекса и общей статистики
+    uint64_t GetGeneration() const;
+    double ComputeTermFreq(const Posting& posting) const;
+
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> SelectTopDocuments(const ExecutionPolicy& policy, const Query& query,
+                                             DocumentPredicate document_predicate, size_t max_document_count) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<std::vector<Document>> FindTopDocumentsBatchImpl(const ExecutionPolicy& policy,
+                                                                 const std::vector<std::string>& raw_queries,
+                                                                 DocumentStatus status,
+                                                                 size_t max_document_count) const;
+    // Выдача запросов queries[indexes[0..count)] в results[indexes[i]]
+    void FindTopDocumentsGroup(const std::pmr::vector<Query>& queries, const size_t* indexes, size_t count,
+                               DocumentStatus status, size_t max_document_count,
+                               std::vector<std::vector<Document>>& results) const;
 
+    template<typename ExecutionPolicy>
+    void AddDocumentsImpl(const ExecutionPolicy& policy, const std::vector<NewDocument>& documents);
+
+    void AddTombstone(int document_id);
+    // Убирает документ из всех структур индекса, в том числе помеченный
+    template <typename ExecutionPolicy>
+    void PurgeDocument(const ExecutionPolicy& policy, int document_id);
+    template <typename ExecutionPolicy>
+    void CompactImpl(const ExecutionPolicy& policy);
+
+    // Пересекает отсортированные термы запроса с термами документа
+    matched_tuple MatchParsedQuery(const Query& query, uint32_t ordinal) const;
+    template <typename ExecutionPolicy>
+    std::vector<matched_tuple> MatchDocumentsImpl(const ExecutionPolicy& policy, std::string_view raw_query,
+                                                  const std::vector<int>& document_ids) const;
+
+    // Проверка документа по порядковому номеру. DocumentFilter проверяется по
+    // битовой карте статуса, а диапазон рейтинга - по столбцу: для длинных
+    // запросов карта рейтинга строится заранее в filter_bits. Произвольный
+    // предикат вызывается со значениями из столбцов. Документы из excluded
+    // не проходят проверку
+    template <typename DocumentPredicate>
+    auto MakeDocumentCheck(const DocumentPredicate& document_predicate, const Query& query,
+                           const std::pmr::vector<uint64_t>& excluded,
+                           std::pmr::vector<uint64_t>& filter_bits) const;
+
+    // Найденные документы лежат в памяти запроса
     template<typename ExecutionPolicy, typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(ExecutionPolicy& policy, const SearchServer::Query& query,
-                                            DocumentPredicate document_predicate) const;
+    std::pmr::vector<Document> FindAllDocuments(ExecutionPolicy& policy, const SearchServer::Query& query,
+                                                DocumentPredicate document_predicate) const;
+
+    template<typename DocumentPredicate>
+    void FindTopDocumentsMaxScore(const SearchServer::Query& query, DocumentPredicate document_predicate,
+                                  TopDocumentsCollector& collector) const;
 };
 
 //          TEMPLATE FUNCTIONS REALIZATION
@@ -121,83 +380,302 @@ std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& poli
 }
 
 template <typename ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(
-        policy,
-        raw_query,
-        [status](int document_id, DocumentStatus document_status, int rating) {
-            return document_status == status;
-        }
-    );
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status,
+                                                     size_t max_document_count) const {
+    MetricsTimer call_timer(metrics_.get(), MetricCall::FIND_TOP_DOCUMENTS);
+    ScratchScope scratch;
+    const auto query = ParseQuery(raw_query, true);
+    const DocumentFilter status_filter{status};
+    if (!query_cache_) {
+        return SelectTopDocuments(policy, query, status_filter, max_document_count);
+    }
+
+    const QueryCacheKey key{{query.plus_terms.begin(), query.plus_terms.end()},
+                            {query.minus_terms.begin(), query.minus_terms.end()}, status, max_document_count};
+    const uint64_t generation = GetGeneration();
+    if (auto documents = query_cache_->Find(key, generation)) {
+        return std::move(*documents);
+    }
+    auto documents = SelectTopDocuments(policy, query, status_filter, max_document_count);
+    query_cache_->Insert(key, generation, documents);
+    return documents;
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
-    return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                                     size_t max_document_count) const {
+    return FindTopDocuments(std::execution::seq, raw_query, document_predicate, max_document_count);
 }
 
 template <typename ExecutionPolicy, typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, 
-                                                    DocumentPredicate document_predicate) const {
-    const auto query = ParseQuery(raw_query, true);
-
-    auto matched_documents = FindAllDocuments(policy, query, document_predicate);
+                                                    DocumentPredicate document_predicate, size_t max_document_count) const {
+    MetricsTimer call_timer(metrics_.get(), MetricCall::FIND_TOP_DOCUMENTS);
+    ScratchScope scratch;
+    return SelectTopDocuments(policy, ParseQuery(raw_query, true), document_predicate, max_document_count);
+}
 
-    std::sort(policy, matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-            return lhs.rating > rhs.rating;
-        } else {
-            return lhs.relevance > rhs.relevance;
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::SelectTopDocuments(const ExecutionPolicy& policy, const SearchServer::Query& query,
+                                                       DocumentPredicate document_predicate, size_t max_document_count) const {
+    TopDocumentsCollector collector(max_document_count);
+    if (query_evaluation_ == QueryEvaluation::MAX_SCORE) {
+        MetricsTimer traversal_timer(metrics_.get(), MetricStage::POSTING_TRAVERSAL);
+        FindTopDocumentsMaxScore(query, document_predicate, collector);
+    } else {
+        const auto documents = FindAllDocuments(policy, query, document_predicate);
+        MetricsTimer ranking_timer(metrics_.get(), MetricStage::RANKING);
+        for (const Document& document : documents) {
+            collector.Add(document);
         }
-    });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+        return collector.Extract();
     }
 
-    return matched_documents;
+    MetricsTimer ranking_timer(metrics_.get(), MetricStage::RANKING);
+    return collector.Extract();
+}
+
+template <typename DocumentPredicate>
+auto SearchServer::MakeDocumentCheck(const DocumentPredicate& document_predicate, const Query& query,
+                                     const std::pmr::vector<uint64_t>& excluded,
+                                     std::pmr::vector<uint64_t>& filter_bits) const {
+    if constexpr (std::is_same_v<DocumentPredicate, DocumentFilter>) {
+        const size_t ordinal_count = ordinal_to_document_id_.size();
+        const size_t word_count = (ordinal_count + 63) / 64;
+        const auto status_index = static_cast<size_t>(document_predicate.status);
+        const uint64_t* bits = status_index < DOCUMENT_STATUS_COUNT ? status_bitmaps_[status_index].data() : nullptr;
+
+        // Карта рейтинга стоит прохода по всему столбцу, поэтому для
+        // коротких списков вхождений рейтинг проверяется на месте
+        bool check_rating = false;
+        bool fold_rating = false;
+        if (document_predicate.HasRatingRange()) {
+            size_t posting_count = 0;
+            for (const TermId term : query.plus_terms) {
+                posting_count += term_postings_[term].size();
+            }
+            check_rating = posting_count * 16 < ordinal_count;
+            fold_rating = !check_rating;
+        }
+        // исключения и рейтинг сворачиваются в одну карту, чтобы на
+        // вхождение приходилась одна проверка бита
+        if (bits == nullptr || !excluded.empty() || fold_rating) {
+            if (bits != nullptr) {
+                filter_bits.assign(bits, bits + word_count);
+            } else {
+                filter_bits.assign(word_count, 0);
+            }
+            for (size_t i = 0; i < excluded.size(); ++i) {
+                filter_bits[i] &= ~excluded[i];
+            }
+            if (fold_rating) {
+                FilterRatingRange(ordinal_to_rating_.data(), ordinal_count, document_predicate.min_rating,
+                                  document_predicate.max_rating, filter_bits.data());
+            }
+            bits = filter_bits.data();
+        }
+        return [bits, check_rating, ratings = ordinal_to_rating_.data(), min_rating = document_predicate.min_rating,
+                max_rating = document_predicate.max_rating](uint32_t ordinal) {
+            return ((bits[ordinal / 64] >> (ordinal % 64)) & 1)
+                && (!check_rating || (ratings[ordinal] >= min_rating && ratings[ordinal] <= max_rating));
+        };
+    } else {
+        const uint64_t* excluded_bits = excluded.empty() ? nullptr : excluded.data();
+        return [this, &document_predicate, excluded_bits](uint32_t ordinal) {
+            return (excluded_bits == nullptr || ((excluded_bits[ordinal / 64] >> (ordinal % 64)) & 1) == 0)
+                && !IsRemoved(ordinal)
+                && document_predicate(ordinal_to_document_id_[ordinal], ordinal_to_status_[ordinal],
+                                      ordinal_to_rating_[ordinal]);
+        };
+    }
 }
 
 template<typename ExecutionPolicy, typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy& policy, const SearchServer::Query& query,
+std::pmr::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy& policy, const SearchServer::Query& query,
     DocumentPredicate document_predicate) const {
     using namespace std;
     
-    ConcurrentMap<int, double> document_to_relevance_par(50);
-    const double documents_count = GetDocumentCount();
-
-
-    for_each(policy, query.plus_words.begin(), query.plus_words.end(),
-             [this, &document_to_relevance_par, documents_count, document_predicate](string_view word){
-                if (word_to_document_freqs_.count(std::string(word))) {
-                    const double inverse_document_freq = ComputeWordInverseDocumentFreq(std::string(word));
-                    for (const auto& [document_id, term_freq] : word_to_document_freqs_.at(std::string(word))) { 
-                        const auto &document = documents_.at(document_id);
-                        if (document_predicate(document_id, document.status, document.rating)) {
-                            document_to_relevance_par[document_id].ref_to_value += term_freq * inverse_document_freq;
+    // Каждая часть слов запроса копит релевантность в своём накопителе,
+    // поэтому потоки не делят память и не берут блокировок
+    size_t part_count = 1;
+    if constexpr (!is_same_v<decay_t<ExecutionPolicy>, execution::sequenced_policy>) {
+        part_count = max<size_t>(1, min<size_t>(query.plus_terms.size(), thread::hardware_concurrency()));
+    }
+    SearchMetrics* const metrics = metrics_.get();
+    // документы с минус-словами отсекаются до подсчёта релевантности и в
+    // накопитель не попадают
+    MetricsTimer minus_filter_timer(metrics, MetricStage::MINUS_FILTER);
+    pmr::memory_resource* const scratch = GetScratchResource();
+    pmr::vector<uint64_t> excluded(scratch);
+    BuildExclusionBitmap(query, excluded);
+    minus_filter_timer.Stop();
+
+    MetricsTimer traversal_timer(metrics, MetricStage::POSTING_TRAVERSAL);
+    ScoreAccumulatorLease accumulators(part_count, ordinal_to_document_id_.size());
+    pmr::vector<uint64_t> filter_bits(scratch);
+    const auto is_eligible = MakeDocumentCheck(document_predicate, query, excluded, filter_bits);
+
+    pmr::vector<size_t> parts(part_count, scratch);
+    iota(parts.begin(), parts.end(), 0);
+    for_each(policy, parts.begin(), parts.end(),
+             [this, &accumulators, &query, part_count, &is_eligible](size_t part) {
+                ScoreAccumulator& accumulator = accumulators[part];
+                for (size_t i = part; i < query.plus_terms.size(); i += part_count) {
+                    const TermId term = query.plus_terms[i];
+                    const double inverse_document_freq = ComputeTermInverseDocumentFreq(term);
+                    for (const Posting& posting : term_postings_[term].GetView()) {
+                        if (is_eligible(posting.document_id)) {
+                            accumulator.Add(posting.document_id, ComputeTermFreq(posting) * inverse_document_freq);
                         }
                     }
                 }
     });
 
-    map<int, double> document_to_relevance = document_to_relevance_par.BuildOrdinaryMap();
+    ScoreAccumulator& document_to_relevance = accumulators[0];
+    for (size_t part = 1; part < part_count; ++part) {
+        document_to_relevance.MergeFrom(accumulators[part]);
+    }
+    traversal_timer.Stop();
 
-    for_each(query.minus_words.begin(), query.minus_words.end(),
-             [this, &document_to_relevance](string_view word){
-                if (word_to_document_freqs_.count(std::string(word)) != 0) {
-                    for (const auto& [document_id, term_freq] : word_to_document_freqs_.at(std::string(word))) {
-                        if (document_to_relevance.count(document_id)) {
-                            document_to_relevance.erase(document_id);
-                        }
-                    }
-                }
+    if (metrics != nullptr) {
+        // каждое вхождение плюс- и минус-слов просматривается ровно один раз
+        uint64_t posting_count = 0;
+        for (const TermId term : query.plus_terms) {
+            posting_count += term_postings_[term].size();
+        }
+        for (const TermId term : query.minus_terms) {
+            posting_count += term_postings_[term].size();
+        }
+        metrics->AddPostingsScanned(posting_count);
+        metrics->AddDocumentsScored(document_to_relevance.GetTouchedCount());
+    }
+
+    MetricsTimer materialization_timer(metrics, MetricStage::MATERIALIZATION);
+    pmr::vector<Document> matched_documents(scratch);
+    matched_documents.reserve(document_to_relevance.GetTouchedCount());
+    document_to_relevance.ForEach([this, &matched_documents](uint32_t ordinal, double relevance) {
+        matched_documents.push_back(Document{ordinal_to_document_id_[ordinal], relevance, ordinal_to_rating_[ordinal]});
     });
+    return matched_documents;
+}
+
+template<typename DocumentPredicate>
+void SearchServer::FindTopDocumentsMaxScore(const SearchServer::Query& query, DocumentPredicate document_predicate,
+                                            TopDocumentsCollector& collector) const {
+    using namespace std;
+
+    struct TermCursor {
+        PostingListView::Iterator it;
+        PostingListView::Iterator end;
+        double inverse_document_freq;
+        double max_score;
+    };
 
-    vector<Document> matched_documents;
-    matched_documents.reserve(document_to_relevance.size());
-    for (const auto& [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back(Document{document_id, relevance, documents_.at(document_id).rating});
+    // минус-слова здесь проверяются отдельно, см. is_excluded
+    pmr::memory_resource* const scratch = GetScratchResource();
+    const pmr::vector<uint64_t> no_exclusions(scratch);
+    pmr::vector<uint64_t> filter_bits(scratch);
+    const auto is_eligible = MakeDocumentCheck(document_predicate, query, no_exclusions, filter_bits);
+
+    pmr::vector<TermCursor> cursors(scratch);
+    cursors.reserve(query.plus_terms.size());
+    for (const TermId term : query.plus_terms) {
+        const PostingListView postings = term_postings_[term].GetView();
+        const double inverse_document_freq = ComputeTermInverseDocumentFreq(term);
+        cursors.push_back({postings.begin(), postings.end(), inverse_document_freq,
+                           term_max_freqs_[term] * inverse_document_freq});
+    }
+    // по возрастанию вклада: слабые слова первыми становятся необязательными
+    sort(cursors.begin(), cursors.end(), [](const TermCursor& lhs, const TermCursor& rhs) {
+        return lhs.max_score < rhs.max_score;
+    });
+    // max_score_prefix[i] - верхняя оценка релевантности по словам [0, i)
+    pmr::vector<double> max_score_prefix(cursors.size() + 1, 0.0, scratch);
+    for (size_t i = 0; i < cursors.size(); ++i) {
+        max_score_prefix[i + 1] = max_score_prefix[i] + cursors[i].max_score;
+    }
+
+    // Минус-слова проверяются лениво, только у документов, претендующих на
+    // выдачу: у частых термов по битовой карте, у остальных продвижением
+    // по списку вхождений
+    pmr::vector<const OrdinalBitmap*> minus_bitmaps(scratch);
+    pmr::vector<pair<PostingListView::Iterator, PostingListView::Iterator>> minus_cursors(scratch);
+    for (const TermId term : query.minus_terms) {
+        if (term_bitmaps_[term]) {
+            minus_bitmaps.push_back(term_bitmaps_[term].get());
+            continue;
+        }
+        const PostingListView postings = term_postings_[term].GetView();
+        minus_cursors.emplace_back(postings.begin(), postings.end());
+    }
+    const auto is_excluded = [&minus_bitmaps, &minus_cursors](int ordinal) {
+        for (const OrdinalBitmap* bitmap : minus_bitmaps) {
+            if (bitmap->Contains(ordinal)) {
+                return true;
+            }
+        }
+        for (auto& [it, end] : minus_cursors) {
+            it.SkipTo(ordinal);
+            if (it != end && it->document_id == ordinal) {
+                return true;
+            }
+        }
+        return false;
+    };
+    // документ не попадёт в выдачу, только если его оценка меньше порога
+    // больше чем на EPSILON: иначе его может поднять рейтинг
+    const auto cannot_enter = [&collector](double max_relevance) {
+        return max_relevance + EPSILON < collector.GetThreshold();
+    };
+
+    // документы, содержащие только слова [0, first_essential), пропускаются
+    size_t first_essential = 0;
+    // вхождения здесь пропускаются блоками, поэтому считаются только документы
+    uint64_t scored_count = 0;
+    while (first_essential < cursors.size()) {
+        while (first_essential < cursors.size() && cannot_enter(max_score_prefix[first_essential + 1])) {
+            ++first_essential;
+        }
+        int ordinal = numeric_limits<int>::max();
+        for (size_t i = first_essential; i < cursors.size(); ++i) {
+            if (cursors[i].it != cursors[i].end) {
+                ordinal = min(ordinal, cursors[i].it->document_id);
+            }
+        }
+        if (ordinal == numeric_limits<int>::max()) {
+            break;
+        }
+
+        ++scored_count;
+        double relevance = 0.0;
+        for (size_t i = first_essential; i < cursors.size(); ++i) {
+            if (cursors[i].it != cursors[i].end && cursors[i].it->document_id == ordinal) {
+                relevance += ComputeTermFreq(*cursors[i].it) * cursors[i].inverse_document_freq;
+                ++cursors[i].it;
+            }
+        }
+        if (!is_eligible(ordinal)) {
+            continue;
+        }
+        bool pruned = false;
+        for (size_t i = first_essential; i-- > 0;) {
+            if (cannot_enter(relevance + max_score_prefix[i + 1])) {
+                pruned = true;
+                break;
+            }
+            cursors[i].it.SkipTo(ordinal);
+            if (cursors[i].it != cursors[i].end && cursors[i].it->document_id == ordinal) {
+                relevance += ComputeTermFreq(*cursors[i].it) * cursors[i].inverse_document_freq;
+            }
+        }
+        if (pruned || cannot_enter(relevance) || is_excluded(ordinal)) {
+            continue;
+        }
+        collector.Add({ordinal_to_document_id_[ordinal], relevance, ordinal_to_rating_[ordinal]});
+    }
+    if (metrics_) {
+        metrics_->AddDocumentsScored(scored_count);
     }
-    return matched_documents;
 }
 
 void AddDocument(SearchServer& search_server, int document_id, const std::string_view document, DocumentStatus status,
@@ -0,0 +1,252 @@
+#include "segmented_search_server.h"
+
+#include <limits>
+
+using namespace std;
+
+SegmentedSearchServer::Segment::Segment(const vector<string>& stop_words, size_t seal)
+    : index(stop_words)
+    , first_seal(seal)
+    , last_seal(seal) {
+}
+
+SegmentedSearchServer::SegmentedSearchServer(const string& stop_words_text, size_t buffer_size, size_t merge_factor)
+    : SegmentedSearchServer(SplitIntoWords(stop_words_text), buffer_size, merge_factor)
+{
+}
+
+SegmentedSearchServer::~SegmentedSearchServer() {
+    {
+        lock_guard guard(merger_mutex_);
+        stopping_ = true;
+    }
+    merger_cv_.notify_one();
+    merger_.join();
+}
+
+void SegmentedSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status,
+                                        const vector<int>& ratings) {
+    const auto lock = LockForWrite();
+    // буфер знает только свои документы, а id может быть занят в сегменте
+    if (document_ids_.count(document_id) > 0) {
+        throw invalid_argument("Invalid document_id"s);
+    }
+    buffer_->index.AddDocument(document_id, document, status, ratings);
+    statistics_->AddDocument(buffer_->index.GetWordFrequencies(document_id));
+    document_ids_.insert(document_id);
+    document_to_seal_[document_id] = buffer_->first_seal;
+    if (static_cast<size_t>(buffer_->index.GetDocumentCount()) >= buffer_size_) {
+        SealBuffer();
+    }
+}
+
+void SegmentedSearchServer::RemoveDocument(int document_id) {
+    const auto lock = LockForWrite();
+    if (document_ids_.count(document_id) == 0) {
+        throw out_of_range("Document "s + to_string(document_id) + " not found"s);
+    }
+    Segment& segment = GetSegment(document_id);
+    statistics_->RemoveDocument(segment.index.GetWordFrequencies(document_id));
+    segment.index.RemoveDocument(document_id);
+    if (&segment != buffer_.get()) {
+        segment.removed_ids.push_back(document_id);
+    }
+    document_ids_.erase(document_id);
+    document_to_seal_.erase(document_id);
+}
+
+vector<Document> SegmentedSearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status,
+                                                         size_t max_document_count) const {
+    return FindTopDocuments(raw_query, DocumentFilter{status}, max_document_count);
+}
+
+vector<Document> SegmentedSearchServer::FindTopDocuments(string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+SearchServer::matched_tuple SegmentedSearchServer::MatchDocument(string_view raw_query, int document_id) const {
+    const auto lock = LockForRead();
+    if (document_ids_.count(document_id) == 0) {
+        throw out_of_range("Document "s + to_string(document_id) + " not found"s);
+    }
+    auto result = GetSegment(document_id).index.MatchDocument(raw_query, document_id);
+    for (string_view& word : get<0>(result)) {
+        word = statistics_->FindWord(word);
+    }
+    return result;
+}
+
+int SegmentedSearchServer::GetDocumentCount() const {
+    const auto lock = LockForRead();
+    return statistics_->GetDocumentCount();
+}
+
+size_t SegmentedSearchServer::GetSegmentCount() const {
+    const auto lock = LockForRead();
+    return segments_.size();
+}
+
+void SegmentedSearchServer::Flush() {
+    const auto lock = LockForWrite();
+    SealBuffer();
+}
+
+void SegmentedSearchServer::WaitForMerges() {
+    unique_lock lock(merger_mutex_);
+    merges_done_cv_.wait(lock, [this] {
+        return !merge_requested_ && !merging_;
+    });
+}
+
+shared_lock<shared_mutex> SegmentedSearchServer::LockForRead() const {
+    {
+        lock_guard guard(turnstile_);
+    }
+    return shared_lock(mutex_);
+}
+
+unique_lock<shared_mutex> SegmentedSearchServer::LockForWrite() const {
+    lock_guard guard(turnstile_);
+    return unique_lock(mutex_);
+}
+
+unique_ptr<SegmentedSearchServer::Segment> SegmentedSearchServer::MakeBuffer(size_t seal) const {
+    auto buffer = make_unique<Segment>(stop_words_, seal);
+    buffer->index.SetCollectionStatistics(statistics_.get());
+    return buffer;
+}
+
+const SegmentedSearchServer::Segment& SegmentedSearchServer::GetSegment(int document_id) const {
+    const size_t seal = document_to_seal_.at(document_id);
+    if (seal >= buffer_->first_seal) {
+        return *buffer_;
+    }
+    const auto it = upper_bound(segments_.begin(), segments_.end(), seal,
+                                [](size_t seal, const shared_ptr<Segment>& segment) {
+                                    return seal < segment->first_seal;
+                                });
+    return **prev(it);
+}
+
+SegmentedSearchServer::Segment& SegmentedSearchServer::GetSegment(int document_id) {
+    return const_cast<Segment&>(static_cast<const SegmentedSearchServer&>(*this).GetSegment(document_id));
+}
+
+void SegmentedSearchServer::SealBuffer() {
+    if (buffer_->index.GetDocumentCount() == 0) {
+        return;
+    }
+    // запечатанный сегмент только помечает удалённые документы: его в это
+    // время может читать слияние
+    buffer_->index.SetRemovalMode(RemovalMode::DEFERRED);
+    const size_t next_seal = buffer_->last_seal + 1;
+    segments_.push_back(move(buffer_));
+    buffer_ = MakeBuffer(next_seal);
+    RequestMerge();
+}
+
+void SegmentedSearchServer::RequestMerge() {
+    {
+        lock_guard guard(merger_mutex_);
+        merge_requested_ = true;
+    }
+    merger_cv_.notify_one();
+}
+
+void SegmentedSearchServer::RunMerger() {
+    unique_lock lock(merger_mutex_);
+    while (true) {
+        merger_cv_.wait(lock, [this] {
+            return merge_requested_ || stopping_;
+        });
+        if (stopping_) {
+            return;
+        }
+        merge_requested_ = false;
+        merging_ = true;
+        while (!stopping_) {
+            lock.unlock();
+            const bool merged = MergeOnce();
+            lock.lock();
+            if (!merged) {
+                break;
+            }
+        }
+        merging_ = false;
+        merges_done_cv_.notify_all();
+    }
+}
+
+bool SegmentedSearchServer::MergeOnce() {
+    // Ищется самый нижний ярус, где подряд идут merge_factor_ сегментов:
+    // мелкие сегменты сливаются чаще и дёшево, крупные - редко
+    vector<shared_ptr<Segment>> inputs;
+    vector<set<int>> skipped_ids;
+    vector<size_t> removed_counts;
+    {
+        const auto lock = LockForRead();
+        vector<size_t> tiers(segments_.size());
+        transform(segments_.begin(), segments_.end(), tiers.begin(), [this](const auto& segment) {
+            return GetTier(*segment);
+        });
+        size_t best_tier = numeric_limits<size_t>::max();
+        size_t best_first = 0;
+        size_t run_first = 0;
+        for (size_t i = 0; i < tiers.size(); ++i) {
+            if (tiers[i] != tiers[run_first]) {
+                run_first = i;
+            }
+            if (i + 1 - run_first == merge_factor_) {
+                if (tiers[run_first] < best_tier) {
+                    best_tier = tiers[run_first];
+                    best_first = run_first;
+                }
+                run_first = i + 1;
+            }
+        }
+        if (best_tier == numeric_limits<size_t>::max()) {
+            return false;
+        }
+        inputs.assign(segments_.begin() + best_first, segments_.begin() + best_first + merge_factor_);
+        for (const auto& input : inputs) {
+            skipped_ids.emplace_back(input->removed_ids.begin(), input->removed_ids.end());
+            removed_counts.push_back(input->removed_ids.size());
+        }
+    }
+
+    // Слияние идёт без блокировки: сегменты-источники не пополняются, а
+    // пометки удалённых, которые могут появиться в них тем временем,
+    // AppendIndex не читает
+    auto merged = make_shared<Segment>(stop_words_, inputs.front()->first_seal);
+    merged->last_seal = inputs.back()->last_seal;
+    merged->index.SetRemovalMode(RemovalMode::DEFERRED);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        merged->index.AppendIndex(inputs[i]->index, skipped_ids[i]);
+    }
+
+    const auto lock = LockForWrite();
+    // документы, удалённые во время слияния, помечаются и в новом сегменте
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        const auto& removed_ids = inputs[i]->removed_ids;
+        for (size_t j = removed_counts[i]; j < removed_ids.size(); ++j) {
+            merged->index.RemoveDocument(removed_ids[j]);
+            merged->removed_ids.push_back(removed_ids[j]);
+        }
+    }
+    merged->index.SetCollectionStatistics(statistics_.get());
+    // новые сегменты только дописываются в конец, поэтому источники
+    // по-прежнему идут подряд
+    const auto first = find(segments_.begin(), segments_.end(), inputs.front());
+    *first = move(merged);
+    segments_.erase(first + 1, first + inputs.size());
+    return true;
+}
+
+size_t SegmentedSearchServer::GetTier(const Segment& segment) const {
+    const auto document_count = static_cast<size_t>(segment.index.GetDocumentCount());
+    size_t tier = 0;
+    for (size_t bound = buffer_size_ * merge_factor_; document_count >= bound; bound *= merge_factor_) {
+        ++tier;
+    }
+    return tier;
+}
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <execution>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "collection_statistics.h"
+#include "document.h"
+#include "search_server.h"
+#include "top_documents.h"
+
+// Индекс из сегментов в духе LSM-дерева. Новые документы попадают в
+// небольшой изменяемый буфер; когда в нём набирается buffer_size
+// документов, он запечатывается в сегмент. Запечатанный сегмент больше не
+// пополняется, удаление лишь помечает в нём документ. Фоновый поток
+// сливает соседние сегменты одного яруса по merge_factor штук: ярус
+// сегмента - сколько раз его размер больше буфера в merge_factor раз. При
+// слиянии списки вхождений переносятся без разбора текстов, а помеченные
+// документы выбрасываются.
+//
+// Запись меняет только буфер и общую статистику, поэтому её цена не
+// зависит от размера индекса. Запрос выполняется на всех сегментах
+// параллельно с общим IDF, лучшие документы сливаются в одну выдачу.
+// Запросы и запись разделяют блокировку чтения-записи с приоритетом
+// писателя; слияние идёт без неё и берёт её только на подмену сегментов
+class SegmentedSearchServer {
+public:
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 4096;
+    static constexpr size_t DEFAULT_MERGE_FACTOR = 4;
+
+    template <typename StringContainer>
+    explicit SegmentedSearchServer(const StringContainer& stop_words, size_t buffer_size = DEFAULT_BUFFER_SIZE,
+                                   size_t merge_factor = DEFAULT_MERGE_FACTOR);
+    explicit SegmentedSearchServer(const std::string& stop_words_text, size_t buffer_size = DEFAULT_BUFFER_SIZE,
+                                   size_t merge_factor = DEFAULT_MERGE_FACTOR);
+
+    SegmentedSearchServer(const SegmentedSearchServer&) = delete;
+    SegmentedSearchServer& operator=(const SegmentedSearchServer&) = delete;
+    ~SegmentedSearchServer();
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void RemoveDocument(int document_id);
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                           size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    // Слова результата указывают в словарь общей статистики и остаются
+    // валидными, пока жив сервер, даже если сегмент документа слит
+    SearchServer::matched_tuple MatchDocument(std::string_view raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+    // Число запечатанных сегментов, буфер не считается
+    size_t GetSegmentCount() const;
+
+    // Запечатывает буфер, даже если он заполнен не до конца
+    void Flush();
+    // Ждёт, пока фоновый поток не выполнит все слияния, которых требует
+    // политика ярусов для текущего набора сегментов
+    void WaitForMerges();
+
+private:
+    // Сегмент покрывает запечатывания с first_seal по last_seal: сливаются
+    // только соседние сегменты, поэтому номер запечатывания, в которое
+    // попал документ, однозначно указывает на его сегмент и после слияний
+    struct Segment {
+        Segment(const std::vector<std::string>& stop_words, size_t seal);
+
+        SearchServer index;
+        size_t first_seal;
+        size_t last_seal;
+        // помеченные удалёнными в index, в порядке удаления
+        std::vector<int> removed_ids;
+    };
+
+    const std::vector<std::string> stop_words_;
+    const size_t buffer_size_;
+    const size_t merge_factor_;
+
+    // в куче, чтобы указатели на неё из сегментов переживали их перемещение
+    std::unique_ptr<CollectionStatistics> statistics_;
+    // запечатанные сегменты по возрастанию first_seal
+    std::vector<std::shared_ptr<Segment>> segments_;
+    std::unique_ptr<Segment> buffer_;
+    // номер запечатывания, в которое попал документ; у документов буфера -
+    // его first_seal
+    std::unordered_map<int, size_t> document_to_seal_;
+    std::set<int> document_ids_;
+    mutable std::shared_mutex mutex_;
+    // Писатель держит турникет, пока ждёт mutex_, а читатель проходит через
+    // него перед входом. Так поток запросов не может бесконечно откладывать
+    // запись: новые читатели ждут, пока писатель не получит mutex_
+    mutable std::mutex turnstile_;
+
+    std::mutex merger_mutex_;
+    std::condition_variable merger_cv_;
+    bool merge_requested_ = false;
+    bool merging_ = false;
+    bool stopping_ = false;
+    std::condition_variable merges_done_cv_;
+    std::thread merger_;
+
+    std::shared_lock<std::shared_mutex> LockForRead() const;
+    std::unique_lock<std::shared_mutex> LockForWrite() const;
+    std::unique_ptr<Segment> MakeBuffer(size_t seal) const;
+    const Segment& GetSegment(int document_id) const;
+    Segment& GetSegment(int document_id);
+    // Запечатывает буфер; вызывается под mutex_
+    void SealBuffer();
+    void RequestMerge();
+    void RunMerger();
+    // Выбирает и выполняет одно слияние; false - если сливать нечего
+    bool MergeOnce();
+    size_t GetTier(const Segment& segment) const;
+};
+
+//          TEMPLATE FUNCTIONS REALIZATION
+
+template <typename StringContainer>
+SegmentedSearchServer::SegmentedSearchServer(const StringContainer& stop_words, size_t buffer_size,
+                                             size_t merge_factor)
+    : stop_words_(std::begin(stop_words), std::end(stop_words))
+    , buffer_size_(buffer_size)
+    , merge_factor_(merge_factor)
+    , statistics_(std::make_unique<CollectionStatistics>()) {
+    using namespace std::string_literals;
+    if (buffer_size == 0) {
+        throw std::invalid_argument("Buffer size must be positive"s);
+    }
+    if (merge_factor < 2) {
+        throw std::invalid_argument("Merge factor must be at least 2"s);
+    }
+    // стоп-слова проверяет конструктор первого буфера
+    buffer_ = MakeBuffer(0);
+    merger_ = std::thread([this] {
+        RunMerger();
+    });
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query,
+                                                              DocumentPredicate document_predicate,
+                                                              size_t max_document_count) const {
+    const auto lock = LockForRead();
+    std::vector<const SearchServer*> indexes;
+    indexes.reserve(segments_.size() + 1);
+    for (const auto& segment : segments_) {
+        indexes.push_back(&segment->index);
+    }
+    indexes.push_back(&buffer_->index);
+
+    std::vector<std::vector<Document>> segment_documents(indexes.size());
+    // исключение, вылетевшее из параллельного алгоритма, завершает программу,
+    // поэтому ошибки разбора запроса переносятся в вызывающий поток
+    std::vector<std::exception_ptr> errors(indexes.size());
+    std::vector<size_t> segment_indexes(indexes.size());
+    std::iota(segment_indexes.begin(), segment_indexes.end(), 0);
+    std::for_each(std::execution::par, segment_indexes.begin(), segment_indexes.end(),
+        [&](size_t index) {
+            try {
+                segment_documents[index] = indexes[index]->FindTopDocuments(
+                    std::execution::seq, raw_query, document_predicate, max_document_count);
+            } catch (...) {
+                errors[index] = std::current_exception();
+            }
+        }
+    );
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    TopDocumentsCollector collector(max_document_count);
+    for (const auto& documents : segment_documents) {
+        for (const Document& document : documents) {
+            collector.Add(document);
+        }
+    }
+    return collector.Extract();
+}
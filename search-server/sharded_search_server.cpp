@@ -0,0 +1,78 @@
+#include "sharded_search_server.h"
+
+#include <functional>
+
+using namespace std;
+
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const string& stop_words_text)
+    : ShardedSearchServer(shard_count, SplitIntoWords(stop_words_text))
+{
+}
+
+void ShardedSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status,
+                                      const vector<int>& ratings) {
+    SearchServer& shard = GetShard(document_id);
+    shard.AddDocument(document_id, document, status, ratings);
+    statistics_->AddDocument(shard.GetWordFrequencies(document_id));
+    document_ids_.insert(document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    if (document_ids_.count(document_id) == 0) {
+        throw out_of_range("Document "s + to_string(document_id) + " not found"s);
+    }
+    SearchServer& shard = GetShard(document_id);
+    statistics_->RemoveDocument(shard.GetWordFrequencies(document_id));
+    shard.RemoveDocument(document_id);
+    document_ids_.erase(document_id);
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status,
+                                                       size_t max_document_count) const {
+    return FindTopDocuments(raw_query, DocumentFilter{status}, max_document_count);
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+SearchServer::matched_tuple ShardedSearchServer::MatchDocument(string_view raw_query, int document_id) const {
+    return GetShard(document_id).MatchDocument(raw_query, document_id);
+}
+
+const map<string_view, double>& ShardedSearchServer::GetWordFrequencies(int document_id) const {
+    return GetShard(document_id).GetWordFrequencies(document_id);
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    return statistics_->GetDocumentCount();
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+void ShardedSearchServer::SetQueryEvaluation(QueryEvaluation query_evaluation) {
+    for (SearchServer& shard : shards_) {
+        shard.SetQueryEvaluation(query_evaluation);
+    }
+}
+
+const SearchServer& ShardedSearchServer::GetShard(int document_id) const {
+    return shards_[hash<int>{}(document_id) % shards_.size()];
+}
+
+SearchServer& ShardedSearchServer::GetShard(int document_id) {
+    return shards_[hash<int>{}(document_id) % shards_.size()];
+}
+
+vector<Document> ShardedSearchServer::MergeTopDocuments(const vector<vector<Document>>& shard_documents,
+                                                        size_t max_document_count) {
+    TopDocumentsCollector collector(max_document_count);
+    for (const auto& documents : shard_documents) {
+        for (const Document& document : documents) {
+            collector.Add(document);
+        }
+    }
+    return collector.Extract();
+}
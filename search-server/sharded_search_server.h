@@ -0,0 +1,110 @@
+#pragma once
+
+#include <exception>
+#include <execution>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "collection_statistics.h"
+#include "document.h"
+#include "search_server.h"
+#include "top_documents.h"
+
+// Документы распределены по шардам по хешу id. Поисковый запрос выполняется
+// на всех шардах параллельно, лучшие документы шардов сливаются в общую
+// выдачу. IDF шарды считают по общей статистике коллекции, поэтому
+// релевантность та же, что у одного SearchServer со всеми документами
+class ShardedSearchServer {
+public:
+    template <typename StringContainer>
+    ShardedSearchServer(size_t shard_count, const StringContainer& stop_words);
+    ShardedSearchServer(size_t shard_count, const std::string& stop_words_text);
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void RemoveDocument(int document_id);
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                           size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    // Документ хранится ровно в одном шарде, запрос уходит только туда
+    SearchServer::matched_tuple MatchDocument(std::string_view raw_query, int document_id) const;
+
+    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    int GetDocumentCount() const;
+    size_t GetShardCount() const;
+    void SetQueryEvaluation(QueryEvaluation query_evaluation);
+
+    std::set<int>::const_iterator begin() const {
+        return document_ids_.begin();
+    }
+
+    std::set<int>::const_iterator end() const {
+        return document_ids_.end();
+    }
+
+private:
+    // в куче, чтобы указатели на неё из шардов переживали перемещение сервера
+    std::unique_ptr<CollectionStatistics> statistics_;
+    std::vector<SearchServer> shards_;
+    std::set<int> document_ids_;
+
+    const SearchServer& GetShard(int document_id) const;
+    SearchServer& GetShard(int document_id);
+    static std::vector<Document> MergeTopDocuments(const std::vector<std::vector<Document>>& shard_documents,
+                                                   size_t max_document_count);
+};
+
+//          TEMPLATE FUNCTIONS REALIZATION
+
+template <typename StringContainer>
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const StringContainer& stop_words)
+    : statistics_(std::make_unique<CollectionStatistics>()) {
+    using namespace std::string_literals;
+    if (shard_count == 0) {
+        throw std::invalid_argument("Shard count must be positive"s);
+    }
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.emplace_back(stop_words);
+        shards_.back().SetCollectionStatistics(statistics_.get());
+    }
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                                            size_t max_document_count) const {
+    std::vector<std::vector<Document>> shard_documents(shards_.size());
+    // исключение, вылетевшее из параллельного алгоритма, завершает программу,
+    // поэтому ошибки разбора запроса переносятся в вызывающий поток
+    std::vector<std::exception_ptr> errors(shards_.size());
+    std::vector<size_t> shard_indexes(shards_.size());
+    std::iota(shard_indexes.begin(), shard_indexes.end(), 0);
+
+    std::for_each(std::execution::par, shard_indexes.begin(), shard_indexes.end(),
+        [&](size_t index) {
+            try {
+                shard_documents[index] = shards_[index].FindTopDocuments(
+                    std::execution::seq, raw_query, document_predicate, max_document_count);
+            } catch (...) {
+                errors[index] = std::current_exception();
+            }
+        }
+    );
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    return MergeTopDocuments(shard_documents, max_document_count);
+}
@@ -0,0 +1,211 @@
+#include "snapshot_search_server.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "string_processing.h"
+
+using namespace std;
+
+SnapshotSearchServer::SnapshotSearchServer(const string& path, SnapshotVerification verification) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw runtime_error("Cannot open snapshot file "s + path);
+    }
+    struct stat file_stat{};
+    if (fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(SnapshotHeader)) {
+        close(fd);
+        throw runtime_error("Snapshot file "s + path + " is truncated"s);
+    }
+    size_ = file_stat.st_size;
+    void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw runtime_error("Cannot map snapshot file "s + path);
+    }
+    data_ = static_cast<const uint8_t*>(mapping);
+
+    try {
+        Validate(verification);
+    } catch (...) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+        throw;
+    }
+
+    header_ = reinterpret_cast<const SnapshotHeader*>(data_);
+    documents_ = reinterpret_cast<const SnapshotDocument*>(data_ + header_->documents_offset);
+    terms_ = reinterpret_cast<const SnapshotTerm*>(data_ + header_->terms_offset);
+    stop_words_ = reinterpret_cast<const SnapshotString*>(data_ + header_->stop_words_offset);
+    blocks_ = reinterpret_cast<const PostingBlockHeader*>(data_ + header_->blocks_offset);
+    postings_ = data_ + header_->postings_offset;
+    strings_ = reinterpret_cast<const char*>(data_ + header_->strings_offset);
+}
+
+SnapshotSearchServer::~SnapshotSearchServer() {
+    munmap(const_cast<uint8_t*>(data_), size_);
+}
+
+void SnapshotSearchServer::Validate(SnapshotVerification verification) const {
+    SnapshotHeader header;
+    memcpy(&header, data_, sizeof(header));
+    if (!equal(begin(SNAPSHOT_MAGIC), end(SNAPSHOT_MAGIC), header.magic)) {
+        throw runtime_error("Not a search server snapshot"s);
+    }
+    if (header.version != SNAPSHOT_VERSION || header.header_size != sizeof(SnapshotHeader)) {
+        throw runtime_error("Unsupported snapshot version "s + to_string(header.version));
+    }
+    const uint64_t header_checksum = header.header_checksum;
+    header.header_checksum = 0;
+    if (ComputeSnapshotChecksum(&header, sizeof(header)) != header_checksum) {
+        throw runtime_error("Snapshot header is corrupted"s);
+    }
+    if (header.file_size != size_) {
+        throw runtime_error("Snapshot file size mismatch"s);
+    }
+
+    const auto check_section = [this](uint64_t offset, uint64_t size) {
+        if (offset < sizeof(SnapshotHeader) || offset % 8 != 0 || offset > size_ || size > size_ - offset) {
+            throw runtime_error("Snapshot section is out of bounds"s);
+        }
+    };
+    check_section(header.documents_offset, uint64_t{header.document_count} * sizeof(SnapshotDocument));
+    check_section(header.terms_offset, uint64_t{header.term_count} * sizeof(SnapshotTerm));
+    check_section(header.stop_words_offset, uint64_t{header.stop_word_count} * sizeof(SnapshotString));
+    check_section(header.blocks_offset, uint64_t{header.block_count} * sizeof(PostingBlockHeader));
+    check_section(header.postings_offset, header.postings_size);
+    check_section(header.strings_offset, header.strings_size);
+
+    if (verification == SnapshotVerification::FULL
+        && ComputeSnapshotChecksum(data_ + sizeof(header), size_ - sizeof(header)) != header.body_checksum) {
+        throw runtime_error("Snapshot data is corrupted"s);
+    }
+}
+
+vector<Document> SnapshotSearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status,
+                                                        size_t max_document_count) const {
+    return FindTopDocuments(raw_query, DocumentFilter{status}, max_document_count);
+}
+
+vector<Document> SnapshotSearchServer::FindTopDocuments(string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+SearchServer::matched_tuple SnapshotSearchServer::MatchDocument(string_view raw_query, int document_id) const {
+    const uint32_t rank = FindDocument(document_id);
+    if (rank == header_->document_count) {
+        throw out_of_range("Snapshot out of range"s);
+    }
+
+    const Query query = ParseQuery(raw_query);
+    const auto status = static_cast<DocumentStatus>(documents_[rank].status);
+    vector<string_view> matched_words;
+    for (const uint32_t term : query.minus_terms) {
+        if (GetPostings(term).Contains(rank)) {
+            return {matched_words, status};
+        }
+    }
+    // термы снимка упорядочены по алфавиту, поэтому слова уже отсортированы
+    for (const uint32_t term : query.plus_terms) {
+        if (GetPostings(term).Contains(rank)) {
+            matched_words.push_back(GetString(terms_[term].text));
+        }
+    }
+    return {matched_words, status};
+}
+
+int SnapshotSearchServer::GetDocumentCount() const {
+    return header_->document_count;
+}
+
+uint64_t SnapshotSearchServer::GetLogSequence() const {
+    return header_->log_sequence;
+}
+
+SnapshotSearchServer::Query SnapshotSearchServer::ParseQuery(string_view text) const {
+    Query result;
+    thread_local vector<string_view> words;
+    words.clear();
+    if (!SplitIntoWords(text, words)) {
+        throw invalid_argument("Query contains special symbols"s);
+    }
+    for (string_view word : words) {
+        if (word.empty()) {
+            throw invalid_argument("Query word is empty"s);
+        }
+        bool is_minus = false;
+        if (word[0] == '-') {
+            is_minus = true;
+            word.remove_prefix(1);
+        }
+        if (word.empty() || word[0] == '-') {
+            throw invalid_argument("Query word "s + string(word) + " is invalid"s);
+        }
+        if (IsStopWord(word)) {
+            continue;
+        }
+        const uint32_t term = FindTerm(word);
+        if (term == header_->term_count) {
+            continue;
+        }
+        (is_minus ? result.minus_terms : result.plus_terms).push_back(term);
+    }
+    for (auto* terms : {&result.plus_terms, &result.minus_terms}) {
+        sort(terms->begin(), terms->end());
+        terms->erase(unique(terms->begin(), terms->end()), terms->end());
+    }
+    return result;
+}
+
+bool SnapshotSearchServer::IsStopWord(string_view word) const {
+    const auto* end = stop_words_ + header_->stop_word_count;
+    const auto* it = lower_bound(stop_words_, end, word, [this](const SnapshotString& lhs, string_view rhs) {
+        return GetString(lhs) < rhs;
+    });
+    return it != end && GetString(*it) == word;
+}
+
+uint32_t SnapshotSearchServer::FindTerm(string_view word) const {
+    const auto* end = terms_ + header_->term_count;
+    const auto* it = lower_bound(terms_, end, word, [this](const SnapshotTerm& lhs, string_view rhs) {
+        return GetString(lhs.text) < rhs;
+    });
+    return it != end && GetString(it->text) == word ? static_cast<uint32_t>(it - terms_) : header_->term_count;
+}
+
+uint32_t SnapshotSearchServer::FindDocument(int document_id) const {
+    const auto* end = documents_ + header_->document_count;
+    const auto* it = lower_bound(documents_, end, document_id, [](const SnapshotDocument& lhs, int rhs) {
+        return lhs.id < rhs;
+    });
+    return it != end && it->id == document_id ? static_cast<uint32_t>(it - documents_) : header_->document_count;
+}
+
+string_view SnapshotSearchServer::GetString(const SnapshotString& string) const {
+    if (string.offset > header_->strings_size || string.size > header_->strings_size - string.offset) {
+        throw runtime_error("Snapshot string is out of bounds"s);
+    }
+    return {strings_ + string.offset, string.size};
+}
+
+PostingListView SnapshotSearchServer::GetPostings(uint32_t term) const {
+    const SnapshotTerm& entry = terms_[term];
+    if (entry.first_block > header_->block_count || entry.block_count > header_->block_count - entry.first_block
+        || entry.postings_offset > header_->postings_size) {
+        throw runtime_error("Snapshot term is out of bounds"s);
+    }
+    const PostingBounds bounds{postings_ + header_->postings_size,
+                               static_cast<int>(min<uint32_t>(header_->document_count, numeric_limits<int>::max()))};
+    return PostingListView(blocks_ + entry.first_block, entry.block_count, postings_ + entry.postings_offset, bounds);
+}
+
+double SnapshotSearchServer::ComputeTermInverseDocumentFreq(uint32_t term) const {
+    return log(header_->document_count * 1.0 / terms_[term].posting_count);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "index_snapshot.h"
+#include "posting_list.h"
+#include "score_accumulator.h"
+#include "search_server.h"
+#include "top_documents.h"
+
+// HEADER проверяет только заголовок и границы секций: открытие не читает
+// файл целиком, а ссылки из таблиц и блоки списков проверяются при первом
+// обращении к ним. FULL дополнительно сверяет контрольную сумму всего файла
+enum class SnapshotVerification {
+    HEADER,
+    FULL,
+};
+
+// Поисковый сервер только для чтения поверх файла SearchServer::SaveSnapshot.
+// Файл отображается в память, и запросы читают словарь, списки вхождений и
+// таблицу документов прямо из него. Время открытия не зависит от размера
+// индекса: с диска подгружаются только страницы, которых касаются запросы.
+// Испорченный файл не приводит к чтению за его пределами: запрос, наткнувшийся
+// на испорченную ссылку или блок, бросает runtime_error
+class SnapshotSearchServer {
+public:
+    explicit SnapshotSearchServer(const std::string& path,
+                                  SnapshotVerification verification = SnapshotVerification::HEADER);
+    ~SnapshotSearchServer();
+
+    SnapshotSearchServer(const SnapshotSearchServer&) = delete;
+    SnapshotSearchServer& operator=(const SnapshotSearchServer&) = delete;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                           size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    SearchServer::matched_tuple MatchDocument(std::string_view raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+    uint64_t GetLogSequence() const;
+
+private:
+    // загружает снимок в изменяемый индекс
+    friend class SearchServer;
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+
+    const SnapshotHeader* header_ = nullptr;
+    const SnapshotDocument* documents_ = nullptr;
+    const SnapshotTerm* terms_ = nullptr;
+    const SnapshotString* stop_words_ = nullptr;
+    const PostingBlockHeader* blocks_ = nullptr;
+    const uint8_t* postings_ = nullptr;
+    const char* strings_ = nullptr;
+
+    // номера термов в таблице термов снимка
+    struct Query {
+        std::vector<uint32_t> plus_terms;
+        std::vector<uint32_t> minus_terms;
+    };
+
+    void Validate(SnapshotVerification verification) const;
+
+    Query ParseQuery(std::string_view text) const;
+    bool IsStopWord(std::string_view word) const;
+    // Номер терма или header_->term_count, если такого терма нет
+    uint32_t FindTerm(std::string_view word) const;
+    // Номер документа в таблице документов или header_->document_count
+    uint32_t FindDocument(int document_id) const;
+
+    // Ссылки из таблиц проверяются при обращении, а не при открытии: так
+    // открытие не читает таблицы целиком. Выход за границы бросает
+    // runtime_error
+    std::string_view GetString(const SnapshotString& string) const;
+    // Блоки списка проверяются при распаковке
+    PostingListView GetPostings(uint32_t term) const;
+    double ComputeTermInverseDocumentFreq(uint32_t term) const;
+};
+
+//          TEMPLATE FUNCTIONS REALIZATION
+
+template <typename DocumentPredicate>
+std::vector<Document> SnapshotSearchServer::FindTopDocuments(std::string_view raw_query,
+                                                             DocumentPredicate document_predicate,
+                                                             size_t max_document_count) const {
+    const Query query = ParseQuery(raw_query);
+
+    ScoreAccumulatorLease accumulators(1, header_->document_count);
+    ScoreAccumulator& document_to_relevance = accumulators[0];
+    for (const uint32_t term : query.plus_terms) {
+        const double inverse_document_freq = ComputeTermInverseDocumentFreq(term);
+        for (const Posting& posting : GetPostings(term)) {
+            const SnapshotDocument& document = documents_[posting.document_id];
+            if (document_predicate(document.id, static_cast<DocumentStatus>(document.status), document.rating)) {
+                document_to_relevance.Add(posting.document_id,
+                                          posting.count * (1.0 / document.word_count) * inverse_document_freq);
+            }
+        }
+    }
+    for (const uint32_t term : query.minus_terms) {
+        for (const Posting& posting : GetPostings(term)) {
+            document_to_relevance.Exclude(posting.document_id);
+        }
+    }
+
+    TopDocumentsCollector collector(max_document_count);
+    document_to_relevance.ForEach([this, &collector](uint32_t rank, double relevance) {
+        collector.Add({documents_[rank].id, relevance, documents_[rank].rating});
+    });
+    return collector.Extract();
+}
@@ -1,19 +1,165 @@
 #include"string_processing.h"
 
-std::vector<std::string_view> SplitIntoWords(const std::string_view str) {
-    std::vector<std::string_view> result;
-    int64_t pos = 0;
-    const int64_t pos_end = str.npos;
-    while (true) {
-        int64_t space = str.find(' ', pos);
-        result.push_back(space == pos_end ? str.substr(pos) : str.substr(pos, space - pos));
-        if (space == pos_end) {
-            break;
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define SEARCH_SERVER_SSE2
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SEARCH_SERVER_AVX2
+#endif
+#endif
+
+namespace {
+
+constexpr size_t SCAN_BLOCK_SIZE = 64;
+
+// Бит i - признак байта i блока
+struct BlockMasks {
+    uint64_t spaces = 0;
+    uint64_t controls = 0;
+};
+
+bool IsControl(char c) {
+    return c >= '\0' && c < ' ';
+}
+
+int CountTrailingZeros(uint64_t value) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(value);
+#else
+    int result = 0;
+    while ((value & 1) == 0) {
+        value >>= 1;
+        ++result;
+    }
+    return result;
+#endif
+}
+
+// Байты за концом текста считаются пробелами, чтобы последнее слово
+// закрывалось так же, как остальные
+BlockMasks ScanBlockScalar(const char* data, size_t length) {
+    BlockMasks masks;
+    for (size_t i = 0; i < SCAN_BLOCK_SIZE; ++i) {
+        if (i >= length || data[i] == ' ') {
+            masks.spaces |= uint64_t{1} << i;
+        } else if (IsControl(data[i])) {
+            masks.controls |= uint64_t{1} << i;
         }
-        else {
-            pos = space + 1;
+    }
+    return masks;
+}
+
+#ifdef SEARCH_SERVER_SSE2
+BlockMasks ScanBlockSse2(const char* data) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i minus_one = _mm_set1_epi8(-1);
+    BlockMasks masks;
+    for (size_t i = 0; i < SCAN_BLOCK_SIZE; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i controls = _mm_and_si128(_mm_cmpgt_epi8(bytes, minus_one), _mm_cmplt_epi8(bytes, space));
+        masks.spaces |= static_cast<uint64_t>(static_cast<uint16_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, space)))) << i;
+        masks.controls |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(controls))) << i;
+    }
+    return masks;
+}
+#endif
+
+#ifdef SEARCH_SERVER_AVX2
+__attribute__((target("avx2"))) BlockMasks ScanBlockAvx2(const char* data) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i minus_one = _mm256_set1_epi8(-1);
+    BlockMasks masks;
+    for (size_t i = 0; i < SCAN_BLOCK_SIZE; i += 32) {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const __m256i controls = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, minus_one),
+                                                  _mm256_cmpgt_epi8(space, bytes));
+        masks.spaces |= static_cast<uint64_t>(static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, space)))) << i;
+        masks.controls |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(controls))) << i;
+    }
+    return masks;
+}
+#endif
+
+using ScanFullBlock = BlockMasks (*)(const char*);
+
+ScanFullBlock SelectScanFullBlock() {
+#ifdef SEARCH_SERVER_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        return ScanBlockAvx2;
+    }
+#endif
+#ifdef SEARCH_SERVER_SSE2
+    return ScanBlockSse2;
+#else
+    return [](const char* data) {
+        return ScanBlockScalar(data, SCAN_BLOCK_SIZE);
+    };
+#endif
+}
+
+// Выбирается при первом вызове, а не при инициализации глобальных объектов:
+// SplitIntoWords может понадобиться конструкторам в других единицах трансляции
+ScanFullBlock GetScanFullBlock() {
+    static const ScanFullBlock scan_full_block = SelectScanFullBlock();
+    return scan_full_block;
+}
+
+// Переводит маску пробелов блока в слова. Бит в transitions стоит там, где
+// пробелы сменяются буквами или наоборот: это начала и концы слов
+void EmitWords(std::string_view text, size_t offset, uint64_t spaces, uint64_t& previous_space,
+               size_t& word_begin, std::vector<std::string_view>& words) {
+    uint64_t transitions = spaces ^ ((spaces << 1) | previous_space);
+    while (transitions != 0) {
+        const size_t position = CountTrailingZeros(transitions);
+        if ((spaces >> position) & 1) {
+            words.push_back(text.substr(word_begin, offset + position - word_begin));
+        } else {
+            word_begin = offset + position;
         }
+        transitions &= transitions - 1;
     }
+    previous_space = spaces >> (SCAN_BLOCK_SIZE - 1);
+}
 
+} // namespace
+
+std::vector<std::string_view> SplitIntoWords(const std::string_view str) {
+    std::vector<std::string_view> result;
+    if (!SplitIntoWords(str, result)) {
+        throw std::invalid_argument("Text contains special symbols");
+    }
     return result;
-}
\ No newline at end of file
+}
+
+bool SplitIntoWords(const std::string_view text, std::vector<std::string_view>& words) {
+    uint64_t previous_space = 1;
+    size_t word_begin = 0;
+    size_t offset = 0;
+    const ScanFullBlock scan_full_block = GetScanFullBlock();
+    for (; offset + SCAN_BLOCK_SIZE <= text.size(); offset += SCAN_BLOCK_SIZE) {
+        const BlockMasks masks = scan_full_block(text.data() + offset);
+        if (masks.controls != 0) {
+            return false;
+        }
+        EmitWords(text, offset, masks.spaces, previous_space, word_begin, words);
+    }
+    // хвост короче блока; если его нет, блок из одних пробелов закроет последнее слово
+    const BlockMasks masks = ScanBlockScalar(text.data() + offset, text.size() - offset);
+    if (masks.controls != 0) {
+        return false;
+    }
+    EmitWords(text, offset, masks.spaces, previous_space, word_begin, words);
+    return true;
+}
+
+bool IsValidWord(const std::string_view word) {
+    return std::none_of(word.begin(), word.end(), [](char c) {
+        return IsControl(c);
+    });
+}
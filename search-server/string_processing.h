@@ -1,6 +1,7 @@
 #pragma once
 #include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
 template <typename StringContainer>
@@ -13,4 +14,12 @@ std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContain
     }
     return non_empty_strings;
 }
-std::vector<std::string_view> SplitIntoWords(std::string_view str);
\ No newline at end of file
+// Бросает invalid_argument, если в тексте есть управляющие символы
+std::vector<std::string_view> SplitIntoWords(std::string_view str);
+// Дописывает в words непустые слова text, разделённые пробелами, и заодно
+// проверяет, что в тексте нет управляющих символов: оба поиска идут за один
+// проход по 64 байта (SSE2 или AVX2, если процессор умеет). Возвращает false,
+// если управляющий символ найден; words тогда дописаны не полностью
+bool SplitIntoWords(std::string_view text, std::vector<std::string_view>& words);
+// A valid word must not contain special characters
+bool IsValidWord(std::string_view word);
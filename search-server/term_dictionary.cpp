@@ -0,0 +1,47 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+
+using namespace std;
+
+TermDictionary::TermDictionary(const TermDictionary& other)
+    // все термы помещаются в первый кусок арены
+    : arena_(make_unique<Arena>(max<size_t>(other.arena_->GetCapacity(), 1))) {
+    terms_.reserve(other.terms_.size());
+    term_to_id_.reserve(other.term_to_id_.size());
+    // термы other различны, поэтому вставляются без поиска
+    for (const string_view term : other.terms_) {
+        const string_view stored = terms_.emplace_back(arena_->CopyString(term));
+        term_to_id_.emplace(stored, static_cast<TermId>(terms_.size() - 1));
+    }
+}
+
+TermDictionary& TermDictionary::operator=(const TermDictionary& other) {
+    if (this != &other) {
+        *this = TermDictionary(other);
+    }
+    return *this;
+}
+
+TermId TermDictionary::Intern(string_view term) {
+    if (const auto it = term_to_id_.find(term); it != term_to_id_.end()) {
+        return it->second;
+    }
+    const TermId id = static_cast<TermId>(terms_.size());
+    const string_view stored = terms_.emplace_back(arena_->CopyString(term));
+    term_to_id_.emplace(stored, id);
+    return id;
+}
+
+TermId TermDictionary::Find(string_view term) const {
+    const auto it = term_to_id_.find(term);
+    return it == term_to_id_.end() ? NO_TERM : it->second;
+}
+
+string_view TermDictionary::GetTerm(TermId id) const {
+    return terms_[id];
+}
+
+size_t TermDictionary::GetTermCount() const {
+    return terms_.size();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "arena.h"
+
+using TermId = uint32_t;
+
+// Словарь термов: каждый терм хранится ровно один раз и получает плотный
+// числовой идентификатор. Поиск идёт по string_view без временных строк.
+class TermDictionary {
+public:
+    static constexpr TermId NO_TERM = std::numeric_limits<TermId>::max();
+
+    TermDictionary() = default;
+    // Копия складывает термы в свою арену, и её ключи указывают туда, а не
+    // в строки оригинала; идентификаторы сохраняются
+    TermDictionary(const TermDictionary& other);
+    TermDictionary(TermDictionary&&) = default;
+    TermDictionary& operator=(const TermDictionary& other);
+    TermDictionary& operator=(TermDictionary&&) = default;
+
+    TermId Intern(std::string_view term);
+    TermId Find(std::string_view term) const;
+    std::string_view GetTerm(TermId id) const;
+    size_t GetTermCount() const;
+
+private:
+    // Байты термов лежат подряд в арене и не перемещаются, поэтому
+    // string_view-ключи term_to_id_ остаются валидными, в том числе после
+    // перемещения словаря; освобождаются вместе со словарём
+    std::unique_ptr<Arena> arena_ = std::make_unique<Arena>();
+    std::vector<std::string_view> terms_;
+    std::unordered_map<std::string_view, TermId> term_to_id_;
+};
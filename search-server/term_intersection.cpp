@@ -0,0 +1,93 @@
+#include "term_intersection.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SEARCH_SERVER_SSE2
+#endif
+
+using namespace std;
+
+namespace {
+
+// во столько раз длинный массив должен превосходить короткий, чтобы
+// галоп оказался выгоднее слияния
+constexpr size_t GALLOP_RATIO = 16;
+
+// Первая позиция в [first, last), где элемент не меньше value
+const TermId* Gallop(const TermId* first, const TermId* last, TermId value) {
+    size_t step = 1;
+    const TermId* low = first;
+    while (step < static_cast<size_t>(last - low) && low[step] < value) {
+        low += step;
+        step *= 2;
+    }
+    return lower_bound(low, low + min(step + 1, static_cast<size_t>(last - low)), value);
+}
+
+void IntersectGallop(TermSpan small, TermSpan large, vector<TermId>& result) {
+    const TermId* position = large.data();
+    const TermId* const end = large.data() + large.size();
+    for (const TermId term : small) {
+        position = Gallop(position, end, term);
+        if (position == end) {
+            return;
+        }
+        if (*position == term) {
+            result.push_back(term);
+        }
+    }
+}
+
+void IntersectMerge(TermSpan lhs, TermSpan rhs, vector<TermId>& result) {
+    size_t i = 0;
+    size_t j = 0;
+#ifdef SEARCH_SERVER_SSE2
+    // каждый из 4 элементов lhs сравнивается с каждым из 4 элементов rhs
+    // сдвигами rhs по кругу; затем отстаёт блок с меньшим последним элементом
+    while (i + 4 <= lhs.size() && j + 4 <= rhs.size()) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lhs.data() + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rhs.data() + j));
+        __m128i equal = _mm_cmpeq_epi32(a, b);
+        equal = _mm_or_si128(equal, _mm_cmpeq_epi32(a, _mm_shuffle_epi32(b, _MM_SHUFFLE(0, 3, 2, 1))));
+        equal = _mm_or_si128(equal, _mm_cmpeq_epi32(a, _mm_shuffle_epi32(b, _MM_SHUFFLE(1, 0, 3, 2))));
+        equal = _mm_or_si128(equal, _mm_cmpeq_epi32(a, _mm_shuffle_epi32(b, _MM_SHUFFLE(2, 1, 0, 3))));
+        const int mask = _mm_movemask_ps(_mm_castsi128_ps(equal));
+        for (int k = 0; k < 4; ++k) {
+            if ((mask >> k) & 1) {
+                result.push_back(lhs[i + k]);
+            }
+        }
+        const TermId lhs_last = lhs[i + 3];
+        const TermId rhs_last = rhs[j + 3];
+        i += lhs_last <= rhs_last ? 4 : 0;
+        j += rhs_last <= lhs_last ? 4 : 0;
+    }
+#endif
+    while (i < lhs.size() && j < rhs.size()) {
+        const TermId a = lhs[i];
+        const TermId b = rhs[j];
+        if (a == b) {
+            result.push_back(a);
+        }
+        i += a <= b;
+        j += b <= a;
+    }
+}
+
+} // namespace
+
+void IntersectTerms(TermSpan lhs, TermSpan rhs, vector<TermId>& result) {
+    const TermSpan small = lhs.size() <= rhs.size() ? lhs : rhs;
+    const TermSpan large = lhs.size() <= rhs.size() ? rhs : lhs;
+    if (small.empty()) {
+        return;
+    }
+    if (small.size() * GALLOP_RATIO < large.size()) {
+        IntersectGallop(small, large, result);
+    } else {
+        IntersectMerge(small, large, result);
+    }
+}
+
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "term_dictionary.h"
+
+// Отсортированный массив термов без владения памятью: принимает вектор с
+// любым распределителем, в том числе термы запроса из арены
+class TermSpan {
+public:
+    template <typename Allocator>
+    TermSpan(const std::vector<TermId, Allocator>& terms)
+        : data_(terms.data())
+        , size_(terms.size()) {
+    }
+
+    const TermId* data() const {
+        return data_;
+    }
+    size_t size() const {
+        return size_;
+    }
+    bool empty() const {
+        return size_ == 0;
+    }
+    TermId operator[](size_t index) const {
+        return data_[index];
+    }
+    const TermId* begin() const {
+        return data_;
+    }
+    const TermId* end() const {
+        return data_ + size_;
+    }
+
+private:
+    const TermId* data_;
+    size_t size_;
+};
+
+// Пересечение отсортированных массивов различных термов. Если один массив
+// намного короче другого, позиции его элементов в длинном ищутся галопом:
+// шагами 1, 2, 4... и затем двоичным поиском. Массивы сравнимой длины
+// сливаются блоками по 4 элемента (SSE2) или без ветвлений
+void IntersectTerms(TermSpan lhs, TermSpan rhs, std::vector<TermId>& result);
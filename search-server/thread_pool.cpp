@@ -0,0 +1,104 @@
+#include "thread_pool.h"
+
+using namespace std;
+
+namespace {
+
+struct CurrentWorker {
+    const ThreadPool* pool = nullptr;
+    size_t index = 0;
+};
+
+thread_local CurrentWorker current_worker;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    thread_count = max<size_t>(1, thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers_.push_back(make_unique<Worker>());
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads_.emplace_back([this, i] {
+            WorkerLoop(i);
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard guard(sleep_mutex_);
+        stop_ = true;
+    }
+    wake_up_.notify_all();
+    for (thread& worker_thread : threads_) {
+        worker_thread.join();
+    }
+}
+
+void ThreadPool::Push(Task task) {
+    size_t index = GetCurrentWorker();
+    if (index == workers_.size()) {
+        index = next_worker_.fetch_add(1) % workers_.size();
+    }
+    // счётчик растёт раньше, чем задачу можно украсть: иначе укравший поток
+    // уменьшил бы его первым и он ушёл бы ниже нуля
+    {
+        lock_guard guard(sleep_mutex_);
+        ++queued_;
+    }
+    try {
+        lock_guard guard(workers_[index]->mutex);
+        workers_[index]->tasks.push_back(move(task));
+    } catch (...) {
+        --queued_;
+        throw;
+    }
+    wake_up_.notify_one();
+}
+
+bool ThreadPool::TryRunTask() {
+    const size_t own = GetCurrentWorker();
+    Task task;
+    if (own < workers_.size()) {
+        lock_guard guard(workers_[own]->mutex);
+        if (!workers_[own]->tasks.empty()) {
+            task = move(workers_[own]->tasks.back());
+            workers_[own]->tasks.pop_back();
+        }
+    }
+    for (size_t shift = 1; !task && shift <= workers_.size(); ++shift) {
+        Worker& victim = *workers_[(own + shift) % workers_.size()];
+        lock_guard guard(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = move(victim.tasks.front());
+            victim.tasks.pop_front();
+        }
+    }
+    if (!task) {
+        return false;
+    }
+    --queued_;
+    task();
+    return true;
+}
+
+void ThreadPool::WorkerLoop(size_t index) {
+    current_worker = {this, index};
+    while (true) {
+        if (TryRunTask()) {
+            continue;
+        }
+        unique_lock lock(sleep_mutex_);
+        wake_up_.wait(lock, [this] {
+            return stop_ || queued_.load() > 0;
+        });
+        if (stop_ && queued_.load() == 0) {
+            return;
+        }
+    }
+}
+
+size_t ThreadPool::GetCurrentWorker() const {
+    return current_worker.pool == this ? current_worker.index : workers_.size();
+}
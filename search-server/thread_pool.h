@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков с собственной очередью задач у каждого рабочего потока.
+// Поток берёт задачи с конца своей очереди, а когда она пуста - крадёт с
+// начала чужих. Рабочие потоки живут всё время жизни пула, поэтому их
+// thread_local-буферы (например, накопители релевантности) переиспользуются
+// между пакетами
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t thread_count = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t GetThreadCount() const {
+        return threads_.size();
+    }
+
+    // Вызывает function(i) для каждого i из [0, count) и ждёт завершения всех
+    // вызовов. Вызывающий поток тоже выполняет задачи, поэтому ParallelFor
+    // можно звать изнутри задачи пула. Первое исключение из function
+    // пробрасывается вызывающему
+    template <typename Function>
+    void ParallelFor(size_t count, Function function);
+
+private:
+    using Task = std::function<void()>;
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> queued_{0};
+    std::atomic<size_t> next_worker_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_up_;
+    bool stop_ = false;
+
+    void Push(Task task);
+    // Выполняет одну задачу: свою, если есть, иначе украденную
+    bool TryRunTask();
+    void WorkerLoop(size_t index);
+    // Номер рабочего потока этого пула, на котором идёт вызов, или число потоков
+    size_t GetCurrentWorker() const;
+};
+
+//          TEMPLATE FUNCTIONS REALIZATION
+
+template <typename Function>
+void ThreadPool::ParallelFor(size_t count, Function function) {
+    if (count == 0) {
+        return;
+    }
+    struct Batch {
+        std::atomic<size_t> remaining;
+        std::mutex mutex;
+        std::condition_variable done;
+        std::exception_ptr error;
+    };
+    // частей больше, чем потоков, чтобы у отстающих было что украсть
+    const size_t chunk_count = std::min(count, (threads_.size() + 1) * 4);
+    Batch batch;
+    batch.remaining = chunk_count;
+
+    for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+        const size_t first = count * chunk / chunk_count;
+        const size_t last = count * (chunk + 1) / chunk_count;
+        Push([&batch, &function, first, last] {
+            try {
+                for (size_t i = first; i < last; ++i) {
+                    function(i);
+                }
+            } catch (...) {
+                std::lock_guard guard(batch.mutex);
+                if (!batch.error) {
+                    batch.error = std::current_exception();
+                }
+            }
+            // Уменьшение и оповещение под мьютексом: иначе вызывающий поток
+            // мог бы увидеть ноль, выйти и разрушить batch, пока последняя
+            // часть ещё обращается к его мьютексу и условной переменной
+            std::lock_guard guard(batch.mutex);
+            if (batch.remaining.fetch_sub(1) == 1) {
+                batch.done.notify_all();
+            }
+        });
+    }
+
+    // пока части не разобраны, вызывающий поток выполняет их сам
+    while (batch.remaining.load() != 0 && TryRunTask()) {
+    }
+    std::unique_lock lock(batch.mutex);
+    batch.done.wait(lock, [&batch] {
+        return batch.remaining.load() == 0;
+    });
+    if (batch.error) {
+        std::rethrow_exception(batch.error);
+    }
+}
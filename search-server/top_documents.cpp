@@ -0,0 +1,40 @@
+#include "top_documents.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+bool IsBetterDocument(const Document& lhs, const Document& rhs) {
+    if (abs(lhs.relevance - rhs.relevance) < EPSILON) {
+        return lhs.rating > rhs.rating;
+    } else {
+        return lhs.relevance > rhs.relevance;
+    }
+}
+
+TopDocumentsCollector::TopDocumentsCollector(size_t max_count)
+    : max_count_(max_count) {
+    heap_.reserve(max_count);
+}
+
+void TopDocumentsCollector::Add(const Document& document) {
+    if (heap_.size() < max_count_) {
+        heap_.push_back(document);
+        push_heap(heap_.begin(), heap_.end(), IsBetterDocument);
+    } else if (max_count_ > 0 && IsBetterDocument(document, heap_.front())) {
+        pop_heap(heap_.begin(), heap_.end(), IsBetterDocument);
+        heap_.back() = document;
+        push_heap(heap_.begin(), heap_.end(), IsBetterDocument);
+    }
+}
+
+double TopDocumentsCollector::GetThreshold() const {
+    return IsFull() && max_count_ > 0 ? heap_.front().relevance : numeric_limits<double>::lowest();
+}
+
+vector<Document> TopDocumentsCollector::Extract() {
+    sort_heap(heap_.begin(), heap_.end(), IsBetterDocument);
+    return move(heap_);
+}
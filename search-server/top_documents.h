@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "document.h"
+
+const double EPSILON = 1e-6;
+
+// Порядок выдачи: по убыванию релевантности, а при равной с точностью
+// до EPSILON релевантности - по убыванию рейтинга
+bool IsBetterDocument(const Document& lhs, const Document& rhs);
+
+// Хранит max_count лучших документов в куче, на вершине которой лежит
+// худший из отобранных; документ, который его не лучше, отбрасывается сразу
+class TopDocumentsCollector {
+public:
+    explicit TopDocumentsCollector(size_t max_count);
+
+    void Add(const Document& document);
+
+    bool IsFull() const {
+        return heap_.size() == max_count_;
+    }
+
+    // Релевантность худшего отобранного документа; пока отобрано меньше
+    // max_count документов, подходит любая релевантность
+    double GetThreshold() const;
+
+    // Отобранные документы в порядке выдачи
+    std::vector<Document> Extract();
+
+private:
+    size_t max_count_;
+    std::vector<Document> heap_;
+};
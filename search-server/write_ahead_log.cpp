@@ -0,0 +1,382 @@
+#include "write_ahead_log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <execution>
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "index_snapshot.h"
+#include "snapshot_search_server.h"
+
+using namespace std;
+
+namespace {
+
+template <typename T>
+void Put(string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Читает значения из тела записи, не выходя за его границы
+class PayloadReader {
+public:
+    PayloadReader(const char* data, size_t size)
+        : data_(data)
+        , size_(size) {
+    }
+
+    template <typename T>
+    bool Get(T& value) {
+        if (size_ - position_ < sizeof(value)) {
+            return false;
+        }
+        memcpy(&value, data_ + position_, sizeof(value));
+        position_ += sizeof(value);
+        return true;
+    }
+
+    bool GetString(size_t size, string& value) {
+        if (size_ - position_ < size) {
+            return false;
+        }
+        value.assign(data_ + position_, size);
+        position_ += size;
+        return true;
+    }
+
+    bool AtEnd() const {
+        return position_ == size_;
+    }
+
+private:
+    const char* data_;
+    size_t size_;
+    size_t position_ = 0;
+};
+
+bool DecodeRecord(const char* data, size_t size, LogRecord& record) {
+    PayloadReader reader(data, size);
+    uint8_t operation = 0;
+    int32_t document_id = 0;
+    if (!reader.Get(record.sequence) || !reader.Get(operation) || !reader.Get(document_id)) {
+        return false;
+    }
+    record.operation = static_cast<LogOperation>(operation);
+    record.document_id = document_id;
+    if (record.operation == LogOperation::REMOVE_DOCUMENT) {
+        return reader.AtEnd();
+    }
+    if (record.operation != LogOperation::ADD_DOCUMENT) {
+        return false;
+    }
+    int32_t status = 0;
+    uint32_t rating_count = 0;
+    if (!reader.Get(status) || !reader.Get(rating_count) || rating_count > size / sizeof(int32_t)) {
+        return false;
+    }
+    record.status = static_cast<DocumentStatus>(status);
+    record.ratings.resize(rating_count);
+    for (int& rating : record.ratings) {
+        int32_t value = 0;
+        if (!reader.Get(value)) {
+            return false;
+        }
+        rating = value;
+    }
+    uint32_t text_size = 0;
+    return reader.Get(text_size) && reader.GetString(text_size, record.text) && reader.AtEnd();
+}
+
+struct ParsedLog {
+    uint64_t base_sequence = 0;
+    vector<LogRecord> records;
+    // конец последней целой записи
+    size_t valid_size = 0;
+};
+
+// Заголовки записей разбираются последовательно, а проверка контрольных
+// сумм и разбор тел - параллельно. Записи после первой испорченной
+// отбрасываются, даже если сами они целы
+ParsedLog ParseLog(const string& data) {
+    LogFileHeader header;
+    if (data.size() < sizeof(header)) {
+        throw runtime_error("Write-ahead log is truncated"s);
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    if (!equal(begin(LOG_MAGIC), end(LOG_MAGIC), header.magic)) {
+        throw runtime_error("Not a write-ahead log"s);
+    }
+
+    struct Frame {
+        size_t offset;
+        uint32_t size;
+        uint64_t checksum;
+    };
+    vector<Frame> frames;
+    for (size_t offset = sizeof(header); data.size() - offset >= sizeof(LogRecordHeader);) {
+        LogRecordHeader record_header;
+        memcpy(&record_header, data.data() + offset, sizeof(record_header));
+        offset += sizeof(record_header);
+        if (record_header.payload_size > data.size() - offset) {
+            break;
+        }
+        frames.push_back({offset, record_header.payload_size, record_header.checksum});
+        offset += record_header.payload_size;
+    }
+
+    ParsedLog result;
+    result.base_sequence = header.base_sequence;
+    result.records.resize(frames.size());
+    vector<char> valid(frames.size());
+    vector<size_t> indexes(frames.size());
+    iota(indexes.begin(), indexes.end(), 0);
+    for_each(execution::par, indexes.begin(), indexes.end(), [&](size_t i) {
+        const char* payload = data.data() + frames[i].offset;
+        valid[i] = ComputeSnapshotChecksum(payload, frames[i].size) == frames[i].checksum
+                   && DecodeRecord(payload, frames[i].size, result.records[i])
+                   && result.records[i].sequence == header.base_sequence + i + 1;
+    });
+    const size_t valid_count = find(valid.begin(), valid.end(), 0) - valid.begin();
+    result.records.resize(valid_count);
+    result.valid_size = valid_count == 0 ? sizeof(header) : frames[valid_count - 1].offset + frames[valid_count - 1].size;
+    return result;
+}
+
+string ReadFile(int fd) {
+    string data;
+    char buffer[1 << 16];
+    while (true) {
+        const ssize_t size = read(fd, buffer, sizeof(buffer));
+        if (size < 0 && errno == EINTR) {
+            continue;
+        }
+        if (size < 0) {
+            throw runtime_error("Cannot read write-ahead log"s);
+        }
+        if (size == 0) {
+            return data;
+        }
+        data.append(buffer, size);
+    }
+}
+
+string MakeFileHeader(uint64_t base_sequence) {
+    LogFileHeader header{};
+    copy(begin(LOG_MAGIC), end(LOG_MAGIC), header.magic);
+    header.base_sequence = base_sequence;
+    return string(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+}  // namespace
+
+void SyncDirectory(const string& path) {
+    const size_t slash = path.rfind('/');
+    const string directory = slash == string::npos ? "."s : path.substr(0, max<size_t>(slash, 1));
+    const int fd = open(directory.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+WriteAheadLog::WriteAheadLog(const string& path, WriteAheadLogOptions options)
+    : path_(path)
+    , options_(options) {
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd_ < 0) {
+        throw runtime_error("Cannot open write-ahead log "s + path);
+    }
+    try {
+        const string data = ReadFile(fd_);
+        // заголовок нового файла мог не дописаться до конца
+        if (data.size() < sizeof(LogFileHeader)) {
+            const string header = MakeFileHeader(0);
+            if (ftruncate(fd_, 0) != 0) {
+                throw runtime_error("Cannot truncate write-ahead log "s + path);
+            }
+            WriteAll(header.data(), header.size());
+            fdatasync(fd_);
+            return;
+        }
+        const ParsedLog log = ParseLog(data);
+        last_sequence_ = log.base_sequence + log.records.size();
+        if (log.valid_size < data.size() && ftruncate(fd_, log.valid_size) != 0) {
+            throw runtime_error("Cannot truncate write-ahead log "s + path);
+        }
+    } catch (...) {
+        close(fd_);
+        throw;
+    }
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    try {
+        FlushPending();
+    } catch (...) {
+    }
+    close(fd_);
+}
+
+uint64_t WriteAheadLog::AppendAddDocument(int document_id, string_view text, DocumentStatus status,
+                                          const vector<int>& ratings) {
+    string tail;
+    tail.reserve(3 * sizeof(int32_t) + ratings.size() * sizeof(int32_t) + text.size());
+    Put(tail, static_cast<int32_t>(status));
+    Put(tail, static_cast<uint32_t>(ratings.size()));
+    for (const int rating : ratings) {
+        Put(tail, static_cast<int32_t>(rating));
+    }
+    Put(tail, static_cast<uint32_t>(text.size()));
+    tail += text;
+
+    lock_guard guard(mutex_);
+    return Append(LogOperation::ADD_DOCUMENT, document_id, tail);
+}
+
+uint64_t WriteAheadLog::AppendRemoveDocument(int document_id) {
+    lock_guard guard(mutex_);
+    return Append(LogOperation::REMOVE_DOCUMENT, document_id, {});
+}
+
+void WriteAheadLog::Flush() {
+    lock_guard guard(mutex_);
+    FlushPending();
+}
+
+void WriteAheadLog::Truncate() {
+    lock_guard guard(mutex_);
+    FlushPending();
+    // новый файл пишется рядом и подменяет старый переименованием: при
+    // падении на диске остаётся либо старый журнал, либо новый целиком
+    const string temp_path = path_ + ".tmp"s;
+    const int temp_fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (temp_fd < 0) {
+        throw runtime_error("Cannot create write-ahead log "s + temp_path);
+    }
+    const string header = MakeFileHeader(last_sequence_);
+    if (write(temp_fd, header.data(), header.size()) != static_cast<ssize_t>(header.size()) || fsync(temp_fd) != 0
+        || rename(temp_path.c_str(), path_.c_str()) != 0) {
+        close(temp_fd);
+        throw runtime_error("Cannot replace write-ahead log "s + path_);
+    }
+    SyncDirectory(path_);
+    close(fd_);
+    fd_ = temp_fd;
+}
+
+uint64_t WriteAheadLog::GetLastSequence() const {
+    lock_guard guard(mutex_);
+    return last_sequence_;
+}
+
+LogContents WriteAheadLog::Read(const string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        // журнала ещё нет - нет и записей
+        return {};
+    }
+    string data;
+    try {
+        data = ReadFile(fd);
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+    ParsedLog log = ParseLog(data);
+    return {log.base_sequence, move(log.records)};
+}
+
+uint64_t WriteAheadLog::Append(LogOperation operation, int document_id, string_view tail) {
+    if (failed_) {
+        throw runtime_error("Write-ahead log "s + path_ + " is in a failed state"s);
+    }
+    const uint64_t sequence = last_sequence_ + 1;
+    string payload;
+    payload.reserve(sizeof(sequence) + sizeof(uint8_t) + sizeof(int32_t) + tail.size());
+    Put(payload, sequence);
+    Put(payload, static_cast<uint8_t>(operation));
+    Put(payload, static_cast<int32_t>(document_id));
+    payload += tail;
+
+    LogRecordHeader header{static_cast<uint32_t>(payload.size()), 0,
+                           ComputeSnapshotChecksum(payload.data(), payload.size())};
+    const size_t pending_size = pending_.size();
+    Put(pending_, header);
+    pending_ += payload;
+    ++pending_count_;
+    last_sequence_ = sequence;
+    if (pending_count_ >= max<size_t>(options_.group_size, 1)) {
+        try {
+            FlushPending();
+        } catch (...) {
+            // изменение не применится к индексу, поэтому и записи о нём быть
+            // не должно; остальные записи группы ждут следующей попытки
+            if (!failed_) {
+                pending_.resize(pending_size);
+                --pending_count_;
+                last_sequence_ = sequence - 1;
+            }
+            throw;
+        }
+    }
+    return sequence;
+}
+
+void WriteAheadLog::FlushPending() {
+    if (failed_) {
+        throw runtime_error("Write-ahead log "s + path_ + " is in a failed state"s);
+    }
+    if (pending_count_ == 0) {
+        return;
+    }
+    struct stat file_stat{};
+    if (fstat(fd_, &file_stat) != 0) {
+        throw runtime_error("Cannot write write-ahead log "s + path_);
+    }
+    try {
+        WriteAll(pending_.data(), pending_.size());
+    } catch (...) {
+        // начало группы, успевшее попасть в файл, обрезается: иначе повтор
+        // записал бы группу после него и журнал потерял бы границы записей
+        if (ftruncate(fd_, file_stat.st_size) != 0) {
+            failed_ = true;
+        }
+        throw;
+    }
+    pending_.clear();
+    pending_count_ = 0;
+    // после неудачного fdatasync неизвестно, что дошло до диска, а повторный
+    // вызов может ложно сообщить об успехе
+    if (options_.sync && fdatasync(fd_) != 0) {
+        failed_ = true;
+        throw runtime_error("Cannot sync write-ahead log "s + path_);
+    }
+}
+
+void WriteAheadLog::WriteAll(const char* data, size_t size) {
+    while (size > 0) {
+        const ssize_t written = write(fd_, data, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written < 0) {
+            throw runtime_error("Cannot write write-ahead log "s + path_);
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+SearchServer RecoverSearchServer(const string& snapshot_path, const string& log_path) {
+    SearchServer search_server(SnapshotSearchServer(snapshot_path, SnapshotVerification::FULL));
+    search_server.ReplayWriteAheadLog(log_path);
+    return search_server;
+}
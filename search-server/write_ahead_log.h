@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+// Формат файла журнала изменений индекса.
+//
+//   LogFileHeader
+//   записи: LogRecordHeader, затем payload_size байт тела
+//
+// Тело записи: sequence (uint64), operation (uint8), id документа (int32),
+// для добавления ещё статус (int32), число оценок (uint32), оценки (int32),
+// длина текста (uint32) и текст. Номера записей идут подряд начиная с
+// base_sequence + 1. Контрольная сумма (FNV-1a, как у снимков) покрывает
+// тело, поэтому запись, оборванная падением процесса, отбрасывается при чтении
+
+constexpr char LOG_MAGIC[8] = {'S', 'R', 'C', 'H', 'W', 'A', 'L', '1'};
+
+struct LogFileHeader {
+    char magic[8];
+    // номер записи, после которой начинается файл: записи до него уже
+    // учтены в снимке и отрезаны Truncate
+    uint64_t base_sequence;
+};
+
+struct LogRecordHeader {
+    uint32_t payload_size;
+    uint32_t reserved;
+    uint64_t checksum;
+};
+
+enum class LogOperation : uint8_t {
+    ADD_DOCUMENT = 1,
+    REMOVE_DOCUMENT = 2,
+};
+
+struct LogRecord {
+    uint64_t sequence = 0;
+    LogOperation operation = LogOperation::ADD_DOCUMENT;
+    int document_id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+    std::string text;
+};
+
+struct LogContents {
+    // см. LogFileHeader::base_sequence; 0, если журнала нет
+    uint64_t base_sequence = 0;
+    std::vector<LogRecord> records;
+};
+
+struct WriteAheadLogOptions {
+    // Сколько записей уходит в файл одним write (групповая фиксация). Пока
+    // группа не набрана, записи лежат в памяти процесса и пропадут при его
+    // падении; 1 - каждая запись сразу попадает в ОС
+    size_t group_size = 1;
+    // fdatasync после каждой группы. Без него записи переживают падение
+    // процесса, но не сбой ОС или питания
+    bool sync = true;
+};
+
+// Журнал изменений индекса, дописываемый только в конец. Подключается к
+// SearchServer через SetWriteAheadLog; вызовы потокобезопасны
+class WriteAheadLog {
+public:
+    // Открывает журнал для дописывания или создаёт новый. Повреждённый или
+    // недописанный хвост отрезается, нумерация продолжается с последней
+    // целой записи
+    explicit WriteAheadLog(const std::string& path, WriteAheadLogOptions options = {});
+    // Записывает незавершённую группу
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Возвращают номер добавленной записи
+    uint64_t AppendAddDocument(int document_id, std::string_view text, DocumentStatus status,
+                               const std::vector<int>& ratings);
+    uint64_t AppendRemoveDocument(int document_id);
+
+    // Записывает и синхронизирует незавершённую группу. Если запись группы
+    // не удалась, её начало обрезается в файле, а сама группа остаётся в
+    // памяти до следующей попытки. Если не удалось обрезать файл или
+    // синхронизировать его, журнал считается испорченным и все дальнейшие
+    // вызовы бросают runtime_error
+    void Flush();
+    // Отбрасывает все записи; вызывается после SaveSnapshot, когда они уже
+    // есть в снимке. Файл подменяется атомарно, нумерация продолжается.
+    // Записи, сделанные между SaveSnapshot и Truncate, теряются, и
+    // ReplayWriteAheadLog такой снимок отвергнет
+    void Truncate();
+    uint64_t GetLastSequence() const;
+
+    // Целые записи журнала по порядку и номер, после которого он начинается.
+    // Чтение останавливается на первой повреждённой или недописанной записи;
+    // контрольные суммы и разбор тел идут параллельно
+    static LogContents Read(const std::string& path);
+
+private:
+    const std::string path_;
+    const WriteAheadLogOptions options_;
+    int fd_ = -1;
+    uint64_t last_sequence_ = 0;
+    // записи незавершённой группы, уже в формате файла
+    std::string pending_;
+    size_t pending_count_ = 0;
+    // содержимое файла после сбоя неизвестно, дописывать в него нельзя
+    bool failed_ = false;
+    mutable std::mutex mutex_;
+
+    // Дописывает запись в группу и фиксирует группу, если она набрана;
+    // tail - поля тела после id документа. Если фиксация не удалась, запись
+    // убирается из группы и номер не расходуется. Вызывается под mutex_
+    uint64_t Append(LogOperation operation, int document_id, std::string_view tail);
+    void FlushPending();
+    void WriteAll(const char* data, size_t size);
+};
+
+// Синхронизирует каталог файла path: без этого переименование файла может
+// не пережить сбой ОС. Ошибки игнорируются
+void SyncDirectory(const std::string& path);
+
+// Индекс из снимка SearchServer::SaveSnapshot с повторёнными поверх него
+// записями журнала, которых ещё нет в снимке
+SearchServer RecoverSearchServer(const std::string& snapshot_path, const std::string& log_path);